@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
 #include <libenvpp/env.hpp>
@@ -25,6 +26,28 @@ int main(int argc, char** argv) {
     args::ValueFlag<uint32_t> widthFlag{parser, "width", "Set window width", {'w', "width"}};
     args::ValueFlag<uint32_t> heightFlag{parser, "height", "Set window height", {'h', "height"}};
     args::Flag noGuiFlag{parser, "no-gui", "Disable GUI", { "no-gui"}};
+    args::Flag noCacheFlag{parser, "no-cache", "Do not read or write the preprocessed scene cache (.gscache)", {"no-cache"}};
+    args::Flag asyncLoadFlag{parser, "async-load", "Start rendering immediately and stream the scene in the background", {"async-load"}};
+    args::Flag compactFlag{parser, "compact", "Store splats quantized to fp16 / 8 bit to save GPU memory", {"compact"}};
+    args::ValueFlag<uint32_t> shDegreeFlag{parser, "sh-degree", "Maximum spherical harmonics degree (0-3)", {"sh-degree"}};
+    args::Flag soaFlag{parser, "soa", "Store the splat attributes in separate buffers (structure of arrays)", {"soa"}};
+    args::ValueFlag<float> pruneOpacityFlag{parser, "prune-opacity", "Remove splats below this opacity when loading (default 1/255)", {"prune-opacity"}};
+    args::ValueFlag<float> pruneScaleFlag{parser, "prune-scale", "Remove splats whose largest scale is below this size when loading", {"prune-scale"}};
+    args::Flag spatialOrderFlag{parser, "spatial-order", "Sort the splats along a Morton curve when loading", {"spatial-order"}};
+    args::Flag chunkCullingFlag{parser, "chunk-culling", "Only preprocess the splat chunks in view, implies --spatial-order", {"chunk-culling"}};
+    args::ValueFlag<std::string> exportPrunedFlag{parser, "export-pruned", "Write the pruned scene to this PLY file", {"export-pruned"}};
+    args::ValueFlag<float> lodFlag{parser, "lod", "Draw merged splats where their error is below this many pixels", {"lod"}};
+    args::ValueFlag<uint32_t> vramBudgetFlag{parser, "vram-budget", "Keep at most this many MB of splats on the GPU and page in the rest", {"vram-budget"}};
+    args::ValueFlag<uint32_t> depthBitsFlag{parser, "depth-bits", "Bits of depth precision in the sort keys (1-32, default 18)", {"depth-bits"}};
+    args::Flag onesweepSortFlag{parser, "onesweep-sort", "Sort with a single histogram and a chained scan per digit", {"onesweep-sort"}};
+    args::Flag noOnesweepSortFlag{parser, "no-onesweep-sort", "Sort with a histogram per digit even if the tuning of the device prefers onesweep", {"no-onesweep-sort"}};
+    args::Flag tileSortFlag{parser, "tile-sort", "Bucket the splats by tile and sort every tile on its own", {"tile-sort"}};
+    args::ValueFlag<std::string> pipelineCacheFlag{parser, "pipeline-cache", "Keep the compiled pipelines in this file (default pipeline.vkcache)", {"pipeline-cache"}};
+    args::Flag noPipelineCacheFlag{parser, "no-pipeline-cache", "Compile the pipelines on every start", {"no-pipeline-cache"}};
+    args::ValueFlag<uint32_t> maxWorkgroupSizeFlag{parser, "max-workgroup-size", "Override the maximum workgroup size the device reports", {"max-workgroup-size"}};
+    args::ValueFlag<uint32_t> maxSharedMemoryFlag{parser, "max-shared-memory", "Override the shared memory in bytes the device reports", {"max-shared-memory"}};
+    args::Flag calibrateFlag{parser, "calibrate", "Time the tile sizes and sort variants on this device first and store the fastest", {"calibrate"}};
+    args::ValueFlag<std::string> tuningFileFlag{parser, "tuning-file", "Read and write the tuning of the devices in this file (default tuning.cfg)", {"tuning-file"}};
     args::Positional<std::string> scenePath{parser, "scene", "Path to scene file", "scene.ply"};
 
     try {
@@ -86,6 +109,95 @@ int main(int argc, char** argv) {
         config.enableGui = true;
     }
 
+    if (noCacheFlag) {
+        config.enableSceneCache = false;
+    }
+
+    if (asyncLoadFlag) {
+        config.asyncSceneLoading = true;
+    }
+
+    if (compactFlag) {
+        config.compactSplatStorage = true;
+    }
+
+    if (shDegreeFlag) {
+        config.maxShDegree = std::min(args::get(shDegreeFlag), 3u);
+    }
+
+    if (soaFlag) {
+        config.soaSplatLayout = true;
+    }
+
+    if (pruneOpacityFlag) {
+        config.pruneMinOpacity = args::get(pruneOpacityFlag);
+    }
+
+    if (pruneScaleFlag) {
+        config.pruneMinScale = args::get(pruneScaleFlag);
+    }
+
+    if (spatialOrderFlag) {
+        config.spatialSplatOrder = true;
+    }
+
+    if (chunkCullingFlag) {
+        config.enableChunkCulling = true;
+    }
+
+    if (exportPrunedFlag) {
+        config.prunedScenePath = args::get(exportPrunedFlag);
+    }
+
+    if (lodFlag) {
+        config.enableLod = true;
+        config.lodErrorThreshold = args::get(lodFlag);
+    }
+
+    if (vramBudgetFlag) {
+        config.vramBudgetMB = args::get(vramBudgetFlag);
+    }
+
+    if (depthBitsFlag) {
+        config.depthSortBits = args::get(depthBitsFlag);
+    }
+
+    if (onesweepSortFlag) {
+        config.enableOnesweepSort = true;
+    }
+
+    if (noOnesweepSortFlag) {
+        config.enableOnesweepSort = false;
+    }
+
+    if (tileSortFlag) {
+        config.enableTileSort = true;
+    }
+
+    if (pipelineCacheFlag) {
+        config.pipelineCachePath = args::get(pipelineCacheFlag);
+    }
+
+    if (noPipelineCacheFlag) {
+        config.pipelineCachePath.clear();
+    }
+
+    if (maxWorkgroupSizeFlag) {
+        config.maxWorkgroupSize = args::get(maxWorkgroupSizeFlag);
+    }
+
+    if (maxSharedMemoryFlag) {
+        config.maxSharedMemory = args::get(maxSharedMemoryFlag);
+    }
+
+    if (calibrateFlag) {
+        config.calibrate = true;
+    }
+
+    if (tuningFileFlag) {
+        config.tuningPath = args::get(tuningFileFlag);
+    }
+
     auto width = widthFlag ? args::get(widthFlag) : 1280;
     auto height = heightFlag ? args::get(heightFlag) : 720;
 
@@ -21,6 +21,78 @@ public:
         float far = 1000.0f;
         bool enableGui = false;
 
+        // Write a preprocessed copy of the scene next to it on first load and load from it afterwards
+        bool enableSceneCache = true;
+
+        // Start rendering right away and stream the scene in on a background thread
+        bool asyncSceneLoading = false;
+
+        // Keep splats in a quantized fp16 / 8 bit format on the GPU, about 2.6x less memory than fp32
+        bool compactSplatStorage = false;
+
+        // Drop SH bands above this degree when loading, 0 renders view independent colors only
+        uint32_t maxShDegree = 3;
+
+        // Keep positions, scale / opacity, rotations and SH coefficients in separate buffers, so that culled
+        // splats do not pull their SH coefficients through the cache
+        bool soaSplatLayout = false;
+
+        // Drop splats below these thresholds when loading, the default opacity never contributes to the image
+        float pruneMinOpacity = 1.0f / 255.0f;
+        float pruneMinScale = 0.0f;
+
+        // Sort the splats along a Morton curve when loading, neighbouring shader threads then read nearby splats
+        bool spatialSplatOrder = false;
+
+        // Skip the preprocessing of splat chunks outside of the view frustum. Implies spatialSplatOrder, the chunks
+        // of a scene in file order span all of it and culling them would only cost time.
+        bool enableChunkCulling = false;
+
+        // Also write the pruned scene to this PLY file
+        std::string prunedScenePath;
+
+        // Build a hierarchy of merged splats when loading and draw coarser levels where their error projects to
+        // at most lodErrorThreshold pixels. Implies spatialSplatOrder and enableChunkCulling.
+        bool enableLod = false;
+        float lodErrorThreshold = 1.0f;
+
+        // Keep at most this many MB of splats on the GPU and page the rest in from the scene cache as the view
+        // needs it, 0 loads the whole scene. Implies enableSceneCache and enableChunkCulling.
+        uint32_t vramBudgetMB = 0;
+
+        // Bits of depth in the sort keys, next to the bits of the tile index. 18 keeps about 1e-4 relative depth
+        // precision and fits the keys of screens up to 2560x1440 into 32 bits, 32 sorts by the exact depth.
+        uint32_t depthSortBits = 18;
+
+        // Sort with one histogram for all digits and a chained scan per digit, which reads the keys about half as
+        // often. Falls back to the radix sort on devices that do not keep waiting workgroups running. Unset uses
+        // the sort the calibration found faster on the device, set overrides it either way.
+        std::optional<bool> enableOnesweepSort = std::nullopt;
+
+        // Bucket the tile instances by tile and sort every tile by depth on its own instead of sorting the keys of
+        // all tiles together. Replaces the global sort and depthSortBits.
+        bool enableTileSort = false;
+
+        // Keep the compiled pipelines in this file across runs, it is discarded when the device or driver changes.
+        // An empty path compiles the pipelines on every start.
+        std::string pipelineCachePath = "pipeline.vkcache";
+
+        // Override the device limits the tile size and the radix sort workgroup layout are chosen from, 0 keeps the
+        // limits the device reports
+        uint32_t maxWorkgroupSize = 0;
+        uint32_t maxSharedMemory = 0;
+
+        // Tile size and radix sort blocks per workgroup, 0 keeps the tuned or device default
+        uint32_t tileWidth = 0;
+        uint32_t tileHeight = 0;
+        uint32_t radixSortBlocksPerWorkgroup = 0;
+
+        // Time candidate tile sizes, radix sort blocks per workgroup and sort variants on the scene before rendering
+        // and store the fastest for this device in tuningPath. Every run starts with the values stored for its device,
+        // an empty path neither reads nor writes them.
+        bool calibrate = false;
+        std::string tuningPath = "tuning.cfg";
+
         std::shared_ptr<Window> window;
     };
 
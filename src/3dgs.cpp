@@ -1,4 +1,5 @@
 #include "3dgs.h"
+#include "Calibration.h"
 #include "Renderer.h"
 
 #ifdef VKGS_ENABLE_GLFW
@@ -16,6 +17,10 @@ std::shared_ptr<Window> VulkanSplatting::createMetalWindow(void *caMetalLayer, i
 #endif
 
 void VulkanSplatting::start() {
+    if (configuration.calibrate) {
+        Calibration(configuration).run();
+    }
+
     // Create the renderer
     renderer = std::make_shared<Renderer>(configuration);
     renderer->initialize();
@@ -23,6 +28,10 @@ void VulkanSplatting::start() {
 }
 
 void VulkanSplatting::initialize() {
+    if (configuration.calibrate) {
+        Calibration(configuration).run();
+    }
+
     renderer = std::make_shared<Renderer>(configuration);
     renderer->initialize();
 }
@@ -0,0 +1,118 @@
+#include "Calibration.h"
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Renderer.h"
+#include "spdlog/spdlog.h"
+
+Calibration::Calibration(VulkanSplatting::RendererConfiguration configuration)
+    : configuration(std::move(configuration)) {
+}
+
+DeviceTuning Calibration::run() {
+    spdlog::info("Calibrating, {} frames per candidate", WARMUP_FRAMES + MEASURED_FRAMES);
+
+    DeviceTuning best;
+    auto bestTime = measure(configurationFor(std::nullopt), best);
+    if (!bestTime) {
+        throw std::runtime_error("Failed to render with the device defaults");
+    }
+    spdlog::info("Device {}: {:.3f} ms with the defaults", deviceKey, *bestTime);
+
+    auto tryCandidate = [&](const DeviceTuning& candidate) {
+        if (candidate == best) {
+            return;
+        }
+        DeviceTuning used;
+        auto time = measure(configurationFor(candidate), used);
+        if (!time || used != candidate) {
+            spdlog::info("Skipping {}x{} tiles, {} blocks, onesweep {}: not supported", candidate.tileWidth,
+                         candidate.tileHeight, candidate.radixSortBlocksPerWorkgroup, candidate.onesweepSort);
+            return;
+        }
+        spdlog::info("{}x{} tiles, {} blocks, onesweep {}: {:.3f} ms", candidate.tileWidth, candidate.tileHeight,
+                     candidate.radixSortBlocksPerWorkgroup, candidate.onesweepSort, *time);
+        if (*time < *bestTime) {
+            best = candidate;
+            bestTime = time;
+        }
+    };
+
+    // the render pass runs one workgroup per tile
+    for (auto [width, height]: std::vector<std::pair<uint32_t, uint32_t>>{{16, 16}, {32, 8}, {16, 8}, {8, 8}}) {
+        auto candidate = best;
+        candidate.tileWidth = width;
+        candidate.tileHeight = height;
+        tryCandidate(candidate);
+    }
+
+    // the per tile sort does not use the global sort
+    if (!configuration.enableTileSort) {
+        for (uint32_t blocks: {16u, 32u, 64u, 128u, 256u}) {
+            auto candidate = best;
+            candidate.radixSortBlocksPerWorkgroup = blocks;
+            tryCandidate(candidate);
+        }
+
+        auto candidate = best;
+        candidate.onesweepSort = !best.onesweepSort;
+        tryCandidate(candidate);
+    }
+
+    spdlog::info("Fastest on device {}: {}x{} tiles, {} radix sort blocks per workgroup, onesweep sort {} ({:.3f} ms)",
+                 deviceKey, best.tileWidth, best.tileHeight, best.radixSortBlocksPerWorkgroup, best.onesweepSort,
+                 *bestTime);
+    if (!configuration.tuningPath.empty()) {
+        DeviceTuning::save(configuration.tuningPath, deviceKey, best);
+        spdlog::info("Stored the tuning in {}", configuration.tuningPath);
+    }
+    return best;
+}
+
+VulkanSplatting::RendererConfiguration Calibration::configurationFor(
+    const std::optional<DeviceTuning>& candidate) const {
+    auto candidateConfiguration = configuration;
+    candidateConfiguration.calibrate = false;
+    // every candidate starts from the device defaults and renders the whole scene
+    candidateConfiguration.tuningPath.clear();
+    candidateConfiguration.asyncSceneLoading = false;
+    candidateConfiguration.enableGui = false;
+    if (candidate) {
+        candidateConfiguration.tileWidth = candidate->tileWidth;
+        candidateConfiguration.tileHeight = candidate->tileHeight;
+        candidateConfiguration.radixSortBlocksPerWorkgroup = candidate->radixSortBlocksPerWorkgroup;
+        candidateConfiguration.enableOnesweepSort = candidate->onesweepSort;
+    } else {
+        candidateConfiguration.tileWidth = 0;
+        candidateConfiguration.tileHeight = 0;
+        candidateConfiguration.radixSortBlocksPerWorkgroup = 0;
+        candidateConfiguration.enableOnesweepSort = false;
+    }
+    return candidateConfiguration;
+}
+
+std::optional<double> Calibration::measure(const VulkanSplatting::RendererConfiguration& candidateConfiguration,
+                                           DeviceTuning& used) {
+    try {
+        Renderer renderer(candidateConfiguration);
+        renderer.initialize();
+        used = renderer.getTuning();
+        deviceKey = renderer.getDeviceKey();
+
+        for (uint32_t i = 0; i < WARMUP_FRAMES; i++) {
+            renderer.draw();
+        }
+        double total = 0.0;
+        for (uint32_t i = 0; i < MEASURED_FRAMES; i++) {
+            renderer.draw();
+            total += renderer.getFrameTime();
+        }
+        renderer.stop();
+        return total / MEASURED_FRAMES;
+    } catch (const std::exception& e) {
+        spdlog::warn("Calibration candidate failed: {}", e.what());
+        return std::nullopt;
+    }
+}
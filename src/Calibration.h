@@ -0,0 +1,36 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <optional>
+
+#include "3dgs.h"
+#include "DeviceTuning.h"
+
+// Times the frames of the scene with candidate tile sizes, radix sort blocks per workgroup and sort variants and
+// stores the fastest in the tuning file. The constants are baked into the pipelines, so every candidate renders
+// with a renderer of its own. The candidates are searched one constant at a time, starting from the device
+// defaults.
+class Calibration {
+public:
+    static constexpr uint32_t WARMUP_FRAMES = 20;
+    static constexpr uint32_t MEASURED_FRAMES = 60;
+
+    explicit Calibration(VulkanSplatting::RendererConfiguration configuration);
+
+    // Returns the fastest tuning, which is also stored in the tuning file if the configuration names one
+    DeviceTuning run();
+
+private:
+    VulkanSplatting::RendererConfiguration configuration;
+    std::string deviceKey;
+
+    // Configuration that renders with the candidate, or with the device defaults if there is none
+    VulkanSplatting::RendererConfiguration configurationFor(const std::optional<DeviceTuning>& candidate) const;
+
+    // Average GPU time of a frame in ms, used is set to the constants the renderer ended up with
+    std::optional<double> measure(const VulkanSplatting::RendererConfiguration& candidateConfiguration,
+                                  DeviceTuning& used);
+};
+
+
+#endif //CALIBRATION_H
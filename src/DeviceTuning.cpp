@@ -0,0 +1,80 @@
+#include "DeviceTuning.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+std::string DeviceTuning::deviceKey(vk::PhysicalDevice physicalDevice) {
+    auto properties = physicalDevice.getProperties();
+    std::ostringstream key;
+    key << std::hex << properties.vendorID << ":" << properties.deviceID;
+    return key.str();
+}
+
+std::optional<DeviceTuning> DeviceTuning::load(const std::string& path, const std::string& deviceKey) {
+    std::ifstream file(path);
+    if (!file) {
+        return std::nullopt;
+    }
+
+    // <device key> <tile width> <tile height> <radix sort blocks per workgroup> <onesweep sort>
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string key;
+        DeviceTuning tuning;
+        fields >> key >> tuning.tileWidth >> tuning.tileHeight >> tuning.radixSortBlocksPerWorkgroup
+                >> tuning.onesweepSort;
+        if (key != deviceKey) {
+            continue;
+        }
+        if (!fields || tuning.tileWidth == 0 || tuning.tileHeight == 0 || tuning.radixSortBlocksPerWorkgroup == 0) {
+            spdlog::warn("Ignoring invalid tuning of device {} in {}", deviceKey, path);
+            return std::nullopt;
+        }
+        return tuning;
+    }
+    return std::nullopt;
+}
+
+void DeviceTuning::save(const std::string& path, const std::string& deviceKey, const DeviceTuning& tuning) {
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            std::string key;
+            fields >> key;
+            if (key != deviceKey) {
+                lines.push_back(line);
+            }
+        }
+    }
+    if (lines.empty()) {
+        lines.emplace_back("# device tile_width tile_height radix_sort_blocks_per_workgroup onesweep_sort");
+    }
+    std::ostringstream line;
+    line << deviceKey << " " << tuning.tileWidth << " " << tuning.tileHeight << " "
+            << tuning.radixSortBlocksPerWorkgroup << " " << tuning.onesweepSort;
+    lines.push_back(line.str());
+
+    auto temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::trunc);
+        for (auto& l: lines) {
+            file << l << "\n";
+        }
+        if (!file) {
+            throw std::runtime_error("Failed to write tuning file " + temporaryPath);
+        }
+    }
+    std::filesystem::rename(temporaryPath, path);
+}
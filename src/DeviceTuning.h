@@ -0,0 +1,31 @@
+#ifndef DEVICETUNING_H
+#define DEVICETUNING_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "vulkan/VulkanContext.h"
+
+// Tile size, radix sort layout and sort variant that measured fastest on one device. They are kept in a text file
+// with one line per device, so that a fleet with mixed GPUs can share it.
+struct DeviceTuning {
+    uint32_t tileWidth = 16;
+    uint32_t tileHeight = 16;
+    uint32_t radixSortBlocksPerWorkgroup = 32;
+    bool onesweepSort = false;
+
+    bool operator==(const DeviceTuning& other) const = default;
+
+    // "vendorID:deviceID" of the physical device in hex
+    static std::string deviceKey(vk::PhysicalDevice physicalDevice);
+
+    // The tuning stored for the device, nothing if the file or its line for the device is missing
+    static std::optional<DeviceTuning> load(const std::string& path, const std::string& deviceKey);
+
+    // Replaces the line of the device in the file and keeps the lines of the other devices
+    static void save(const std::string& path, const std::string& deviceKey, const DeviceTuning& tuning);
+};
+
+
+#endif //DEVICETUNING_H
@@ -4,6 +4,22 @@
 
 #include <fstream>
 #include "GSScene.h"
+#include "MappedFile.h"
+#include "SceneCache.h"
+#include "ThreadPool.h"
+#include "vulkan/StagingRing.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
 
 #include <random>
 #include "shaders.h"
@@ -13,66 +29,1148 @@
 #include "vulkan/pipelines/ComputePipeline.h"
 #include "spdlog/spdlog.h"
 #include "vulkan/Shader.h"
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+static constexpr float SH_C0 = 0.28209479177387814f;
+
+static std::optional<PlyScalarType> parsePlyScalarType(const std::string& type) {
+    static const std::unordered_map<std::string, PlyScalarType> types = {
+        {"char", PlyScalarType::INT8}, {"int8", PlyScalarType::INT8},
+        {"uchar", PlyScalarType::UINT8}, {"uint8", PlyScalarType::UINT8},
+        {"short", PlyScalarType::INT16}, {"int16", PlyScalarType::INT16},
+        {"ushort", PlyScalarType::UINT16}, {"uint16", PlyScalarType::UINT16},
+        {"int", PlyScalarType::INT32}, {"int32", PlyScalarType::INT32},
+        {"uint", PlyScalarType::UINT32}, {"uint32", PlyScalarType::UINT32},
+        {"half", PlyScalarType::FLOAT16}, {"float16", PlyScalarType::FLOAT16},
+        {"float", PlyScalarType::FLOAT32}, {"float32", PlyScalarType::FLOAT32},
+        {"double", PlyScalarType::FLOAT64}, {"float64", PlyScalarType::FLOAT64},
+    };
+    auto it = types.find(type);
+    if (it == types.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+static uint32_t plyScalarSize(PlyScalarType type) {
+    switch (type) {
+        case PlyScalarType::INT8:
+        case PlyScalarType::UINT8:
+            return 1;
+        case PlyScalarType::INT16:
+        case PlyScalarType::UINT16:
+        case PlyScalarType::FLOAT16:
+            return 2;
+        case PlyScalarType::INT32:
+        case PlyScalarType::UINT32:
+        case PlyScalarType::FLOAT32:
+            return 4;
+        case PlyScalarType::FLOAT64:
+            return 8;
+    }
+    return 0;
+}
+
+template<typename T>
+static float readPlyScalar(const char* src) {
+    // PLY bodies are not necessarily aligned
+    T value;
+    memcpy(&value, src, sizeof(T));
+    return static_cast<float>(value);
+}
+
+static float readPlyScalar(PlyScalarType type, const char* src) {
+    switch (type) {
+        case PlyScalarType::INT8:
+            return readPlyScalar<int8_t>(src);
+        case PlyScalarType::UINT8:
+            return readPlyScalar<uint8_t>(src);
+        case PlyScalarType::INT16:
+            return readPlyScalar<int16_t>(src);
+        case PlyScalarType::UINT16:
+            return readPlyScalar<uint16_t>(src);
+        case PlyScalarType::INT32:
+            return readPlyScalar<int32_t>(src);
+        case PlyScalarType::UINT32:
+            return readPlyScalar<uint32_t>(src);
+        case PlyScalarType::FLOAT16: {
+            uint16_t bits;
+            memcpy(&bits, src, sizeof(bits));
+            return glm::unpackHalf1x16(bits);
+        }
+        case PlyScalarType::FLOAT32:
+            return readPlyScalar<float>(src);
+        case PlyScalarType::FLOAT64:
+            return readPlyScalar<double>(src);
+    }
+    return 0.0f;
+}
+
+PlyVertexLayout PlyVertexLayout::compile(const PlyHeader& header) {
+    constexpr uint32_t positionOffset = offsetof(GSScene::Vertex, position) / sizeof(float);
+    constexpr uint32_t scaleOffset = offsetof(GSScene::Vertex, scale_opacity) / sizeof(float);
+    constexpr uint32_t opacityOffset = scaleOffset + 3;
+    constexpr uint32_t rotationOffset = offsetof(GSScene::Vertex, rotation) / sizeof(float);
+    constexpr uint32_t shOffset = offsetof(GSScene::Vertex, shs) / sizeof(float);
+
+    PlyVertexLayout layout;
+    layout.stride = header.vertexStride;
+
+    std::unordered_map<std::string, const PlyProperty *> properties;
+    uint32_t numRest = 0;
+    for (auto& property: header.vertexProperties) {
+        properties[property.name] = &property;
+        if (property.name.starts_with("f_rest_")) {
+            numRest++;
+        }
+    }
+
+    auto add = [&](const std::string& name, uint32_t dst, float scale = 1.0f, float bias = 0.0f) {
+        auto it = properties.find(name);
+        if (it == properties.end()) {
+            return false;
+        }
+        layout.gathers.push_back({it->second->offset, it->second->scalarType, dst, scale, bias});
+        return true;
+    };
+
+    for (uint32_t i = 0; i < 3; i++) {
+        if (!add(std::string(1, static_cast<char>('x' + i)), positionOffset + i)) {
+            throw std::runtime_error("PLY file has no vertex position");
+        }
+    }
+
+    bool hasScale = true;
+    for (uint32_t i = 0; i < 3; i++) {
+        hasScale &= add("scale_" + std::to_string(i), scaleOffset + i);
+    }
+    if (!hasScale) {
+        spdlog::warn("PLY file has no scale_0..2, using the default splat scale");
+    }
+    add("opacity", opacityOffset);
+    for (uint32_t i = 0; i < 4; i++) {
+        add("rot_" + std::to_string(i), rotationOffset + i);
+    }
+
+    // Band 0 comes from f_dc_*, or from 8-bit vertex colors for plain point clouds
+    for (uint32_t c = 0; c < 3; c++) {
+        if (!add("f_dc_" + std::to_string(c), shOffset + c)) {
+            static const char* colors[] = {"red", "green", "blue"};
+            auto it = properties.find(colors[c]);
+            if (it != properties.end()) {
+                auto maxValue = it->second->scalarType == PlyScalarType::UINT8 ? 255.0f : 1.0f;
+                add(colors[c], shOffset + c, 1.0f / (maxValue * SH_C0), -0.5f / SH_C0);
+            }
+        }
+    }
+
+    // f_rest_* is stored channel-major: all coefficients of red, then green, then blue
+    auto restPerChannel = numRest / 3;
+    while (layout.shDegree < 3 && (layout.shDegree + 2) * (layout.shDegree + 2) - 1 <= restPerChannel) {
+        layout.shDegree++;
+    }
+    auto usedPerChannel = (layout.shDegree + 1) * (layout.shDegree + 1) - 1;
+    if (usedPerChannel != restPerChannel) {
+        spdlog::warn("PLY file has {} f_rest properties, only using SH degree {}", numRest, layout.shDegree);
+    }
+    for (uint32_t c = 0; c < 3; c++) {
+        for (uint32_t j = 1; j <= usedPerChannel; j++) {
+            add("f_rest_" + std::to_string(c * restPerChannel + j - 1), shOffset + j * 3 + c);
+        }
+    }
+
+    return layout;
+}
+
+static GSScene::Vertex defaultPlyVertex() {
+    GSScene::Vertex vertex{};
+    vertex.scale_opacity = glm::vec4(std::log(0.01f), std::log(0.01f), std::log(0.01f), 10.0f);
+    vertex.rotation = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+    return vertex;
+}
+
+// Stores vertex i of a chunk of chunkSize vertices in the scene's format, split into the given streams
+static void storeVertex(const GSScene::Vertex& vertex, bool compact, uint32_t shDegree,
+                        const std::vector<GSScene::VertexStreamRange>& streams, size_t chunkSize, size_t i,
+                        char* vertices) {
+    GSScene::CompactVertex compactVertex;
+    const char* record = reinterpret_cast<const char *>(&vertex);
+    if (compact) {
+        compactVertex = GSScene::compactVertex(vertex, shDegree);
+        record = reinterpret_cast<const char *>(&compactVertex);
+    }
+
+    for (auto& stream: streams) {
+        memcpy(vertices + i * stream.size, record + stream.offset, stream.size);
+        vertices += chunkSize * stream.size;
+    }
+}
+
+// Gathers one vertex record and applies the activation functions
+static GSScene::Vertex readPlyVertex(const PlyVertexLayout& layout, const GSScene::Vertex& defaultVertex,
+                                     const char* src) {
+    GSScene::Vertex vertex = defaultVertex;
+    auto* dst = reinterpret_cast<float *>(&vertex);
+    for (auto& gather: layout.gathers) {
+        auto value = gather.type == PlyScalarType::FLOAT32
+                         ? readPlyScalar<float>(src + gather.srcOffset)
+                         : readPlyScalar(gather.type, src + gather.srcOffset);
+        dst[gather.dst] = value * gather.scale + gather.bias;
+    }
+
+    vertex.position.w = 1.0f;
+    vertex.scale_opacity = glm::vec4(glm::exp(glm::vec3(vertex.scale_opacity)),
+                                     1.0f / (1.0f + std::exp(-vertex.scale_opacity.w)));
+    vertex.rotation = normalize(vertex.rotation);
+    return vertex;
+}
+
+static GSScene::ChunkBounds emptyChunkBounds() {
+    return {glm::vec3(std::numeric_limits<float>::max()), 0.0f, glm::vec3(std::numeric_limits<float>::lowest()),
+            GSScene::NO_PARENT_CHUNK};
+}
+
+static float maxScale(const GSScene::Vertex& vertex) {
+    return std::max(std::max(vertex.scale_opacity.x, vertex.scale_opacity.y), vertex.scale_opacity.z);
+}
+
+static void growChunkBounds(GSScene::ChunkBounds& bounds, const GSScene::Vertex& vertex) {
+    // a sphere around the largest axis of the 3 sigma ellipsoid, so the rotation does not matter
+    auto radius = 3.0f * maxScale(vertex);
+    auto position = glm::vec3(vertex.position);
+    bounds.min = glm::min(bounds.min, position - radius);
+    bounds.max = glm::max(bounds.max, position + radius);
+}
+
+// R diag(scale^2) R^T, the covariance precomp_cov3d.comp computes
+static glm::mat3 splatCovariance(const glm::vec3& scale, const glm::vec4& rotation) {
+    auto rotationMatrix = glm::mat3_cast(glm::quat(rotation.x, rotation.y, rotation.z, rotation.w));
+    glm::mat3 covariance(0.0f);
+    for (int axis = 0; axis < 3; axis++) {
+        covariance += scale[axis] * scale[axis] * glm::outerProduct(rotationMatrix[axis], rotationMatrix[axis]);
+    }
+    return covariance;
+}
+
+// Stores the covariance of a vertex like precomp_cov3d.comp does, from the attributes as they are stored
+static void storeCov3D(const GSScene::Vertex& vertex, bool compact, char* cov3D) {
+    auto scale = glm::vec3(vertex.scale_opacity);
+    auto rotation = vertex.rotation;
+    if (compact) {
+        scale = glm::vec3(glm::unpackHalf2x16(glm::packHalf2x16(glm::vec2(scale))),
+                          glm::unpackHalf1x16(glm::packHalf1x16(scale.z)));
+        rotation = glm::vec4(glm::unpackHalf2x16(glm::packHalf2x16(glm::vec2(rotation.x, rotation.y))),
+                             glm::unpackHalf2x16(glm::packHalf2x16(glm::vec2(rotation.z, rotation.w))));
+    }
+    auto covariance = splatCovariance(scale, rotation);
+    float upperRight[6] = {covariance[0][0], covariance[0][1], covariance[0][2],
+                           covariance[1][1], covariance[1][2], covariance[2][2]};
+
+    if (!compact) {
+        memcpy(cov3D, upperRight, sizeof(upperRight));
+        return;
+    }
+    GSScene::CompactCov3D packed{};
+    auto largest = std::max(std::max(upperRight[0], upperRight[3]), upperRight[5]);
+    packed.scale = largest > 0.0f ? largest : 1.0f;
+    for (int i = 0; i < 3; i++) {
+        packed.mat[i] = glm::packHalf2x16(glm::vec2(upperRight[2 * i], upperRight[2 * i + 1]) / packed.scale);
+    }
+    memcpy(cov3D, &packed, sizeof(packed));
+}
+
+// Eigen decomposition of a symmetric matrix by cyclic Jacobi rotations, the eigenvectors are the columns of vectors
+static void symmetricEigen(glm::mat3 a, glm::mat3& vectors, glm::vec3& values) {
+    vectors = glm::mat3(1.0f);
+    for (int sweep = 0; sweep < 16; sweep++) {
+        if (a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2] < 1e-30f) {
+            break;
+        }
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (a[q][p] == 0.0f) {
+                    continue;
+                }
+                // rotation in the p, q plane that zeroes a[q][p]
+                auto theta = (a[q][q] - a[p][p]) / (2.0f * a[q][p]);
+                auto t = (theta >= 0.0f ? 1.0f : -1.0f) / (std::abs(theta) + std::sqrt(theta * theta + 1.0f));
+                auto c = 1.0f / std::sqrt(t * t + 1.0f);
+                glm::mat3 rotation(1.0f);
+                rotation[p][p] = c;
+                rotation[q][q] = c;
+                rotation[q][p] = t * c;
+                rotation[p][q] = -t * c;
+                a = glm::transpose(rotation) * a * rotation;
+                vectors = vectors * rotation;
+            }
+        }
+    }
+    values = glm::vec3(a[0][0], a[1][1], a[2][2]);
+}
+
+// Moment matched Gaussian of a group of splats. Each splat is weighted by its opacity times the surface area of its
+// ellipsoid, the merged opacity keeps the covered area of the group and the SH coefficients are averaged.
+static GSScene::Vertex mergeVertices(const GSScene::Vertex* vertices, size_t count) {
+    float weights[GSScene::LOD_BRANCHING];
+    float totalWeight = 0.0f;
+    float coverage = 0.0f;
+    glm::vec3 mean(0.0f);
+    for (size_t i = 0; i < count; i++) {
+        auto scale = glm::vec3(vertices[i].scale_opacity);
+        auto area = scale.x * scale.y + scale.y * scale.z + scale.z * scale.x;
+        coverage += vertices[i].scale_opacity.w * area;
+        weights[i] = std::max(vertices[i].scale_opacity.w * area, std::numeric_limits<float>::min());
+        totalWeight += weights[i];
+        mean += weights[i] * glm::vec3(vertices[i].position);
+    }
+    mean /= totalWeight;
+
+    GSScene::Vertex merged{};
+    glm::mat3 covariance(0.0f);
+    for (size_t i = 0; i < count; i++) {
+        auto& vertex = vertices[i];
+        // the splat's own covariance plus its spread around the merged mean
+        auto offset = glm::vec3(vertex.position) - mean;
+        covariance += weights[i] * (splatCovariance(glm::vec3(vertex.scale_opacity), vertex.rotation) +
+                                    glm::outerProduct(offset, offset));
+        for (int j = 0; j < 48; j++) {
+            merged.shs[j] += weights[i] * vertex.shs[j];
+        }
+    }
+    covariance /= totalWeight;
+    for (float& sh: merged.shs) {
+        sh /= totalWeight;
+    }
+
+    glm::mat3 axes;
+    glm::vec3 variances;
+    symmetricEigen(covariance, axes, variances);
+    if (glm::determinant(axes) < 0.0f) {
+        axes[2] = -axes[2];
+    }
+    auto rotation = glm::quat_cast(axes);
+    auto scale = glm::sqrt(glm::max(variances, glm::vec3(0.0f)));
+    auto area = scale.x * scale.y + scale.y * scale.z + scale.z * scale.x;
 
-struct VertexStorage {
-    glm::vec3 position;
-    glm::vec3 normal;
-    float shs[48];
-    float opacity;
-    glm::vec3 scale;
-    glm::vec4 rotation;
-};
+    merged.position = glm::vec4(mean, 1.0f);
+    merged.scale_opacity = glm::vec4(scale, area > 0.0f ? std::min(coverage / area, 1.0f) : 0.0f);
+    merged.rotation = glm::normalize(glm::vec4(rotation.w, rotation.x, rotation.y, rotation.z));
+    return merged;
+}
+
+// Converts vertices [begin, end) of a chunk, stores them in the scene's format and returns their bounds. Vertex i of
+// the chunk is the record sourceIndices[i] of body, or simply record i without sourceIndices. With proxies, each
+// group of LOD_BRANCHING vertices starting at i is also merged into proxies[i / LOD_BRANCHING], with cov3Ds the
+// covariances are stored as well.
+static GSScene::ChunkBounds convertVertices(const PlyVertexLayout& layout, const char* body,
+                                            const uint32_t* sourceIndices, size_t begin, size_t end, bool compact,
+                                            uint32_t shDegree, const std::vector<GSScene::VertexStreamRange>& streams,
+                                            size_t chunkSize, char* vertices, GSScene::Vertex* proxies,
+                                            char* cov3Ds) {
+    const auto cov3DSize = compact ? sizeof(GSScene::CompactCov3D) : sizeof(GSScene::Cov3DUpperRight);
+    const auto defaultVertex = defaultPlyVertex();
+    auto bounds = emptyChunkBounds();
+    GSScene::Vertex group[GSScene::LOD_BRANCHING];
+    for (auto i = begin; i < end; i++) {
+        const size_t record = sourceIndices ? sourceIndices[i] : i;
+        auto vertex = readPlyVertex(layout, defaultVertex, body + record * layout.stride);
+        storeVertex(vertex, compact, shDegree, streams, chunkSize, i, vertices);
+        growChunkBounds(bounds, vertex);
+        if (cov3Ds) {
+            storeCov3D(vertex, compact, cov3Ds + i * cov3DSize);
+        }
+        if (proxies) {
+            group[i % GSScene::LOD_BRANCHING] = vertex;
+            if (i % GSScene::LOD_BRANCHING == GSScene::LOD_BRANCHING - 1 || i + 1 == end) {
+                proxies[i / GSScene::LOD_BRANCHING] = mergeVertices(group, i % GSScene::LOD_BRANCHING + 1);
+            }
+        }
+    }
+    return bounds;
+}
+
+// spreads the lower 21 bits of value to every third bit
+static uint64_t spreadMortonBits(uint64_t value) {
+    value &= 0x1FFFFF;
+    value = (value | value << 32) & 0x1F00000000FFFFull;
+    value = (value | value << 16) & 0x1F0000FF0000FFull;
+    value = (value | value << 8) & 0x100F00F00F00F00Full;
+    value = (value | value << 4) & 0x10C30C30C30C30C3ull;
+    value = (value | value << 2) & 0x1249249249249249ull;
+    return value;
+}
+
+static bool isFinite(const glm::vec3& value) {
+    return !glm::any(glm::isnan(value)) && !glm::any(glm::isinf(value));
+}
+
+// Reorders indices along a 63 bit Morton curve over the bounds of their positions
+static void sortMortonOrder(ThreadPool& threadPool, const std::vector<glm::vec3>& positions,
+                            std::vector<uint32_t>& indices) {
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    std::mutex boundsMutex;
+    threadPool.parallelFor(indices.size(), [&](size_t begin, size_t end) {
+        glm::vec3 sliceMin(std::numeric_limits<float>::max());
+        glm::vec3 sliceMax(std::numeric_limits<float>::lowest());
+        for (auto i = begin; i < end; i++) {
+            auto& position = positions[indices[i]];
+            if (isFinite(position)) {
+                sliceMin = glm::min(sliceMin, position);
+                sliceMax = glm::max(sliceMax, position);
+            }
+        }
+        std::lock_guard<std::mutex> lock(boundsMutex);
+        boundsMin = glm::min(boundsMin, sliceMin);
+        boundsMax = glm::max(boundsMax, sliceMax);
+    });
+
+    constexpr float gridSize = (1 << 21) - 1;
+    const auto extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+    std::vector<std::pair<uint64_t, uint32_t>> keys(indices.size());
+    threadPool.parallelFor(indices.size(), [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; i++) {
+            auto& position = positions[indices[i]];
+            uint64_t code = 0;
+            if (isFinite(position)) {
+                auto cell = glm::uvec3(glm::clamp((position - boundsMin) / extent, 0.0f, 1.0f) * gridSize);
+                code = spreadMortonBits(cell.x) | spreadMortonBits(cell.y) << 1 | spreadMortonBits(cell.z) << 2;
+            }
+            keys[i] = {code, indices[i]};
+        }
+    });
+
+    // sort one run per worker, then merge neighbouring runs until one is left
+    std::vector<size_t> runs;
+    const auto numRuns = std::min(indices.size(), threadPool.size());
+    for (size_t run = 0; run <= numRuns; run++) {
+        runs.push_back(indices.size() * run / numRuns);
+    }
+    threadPool.parallelFor(numRuns, [&](size_t begin, size_t end) {
+        for (auto run = begin; run < end; run++) {
+            std::sort(keys.begin() + runs[run], keys.begin() + runs[run + 1]);
+        }
+    });
+    for (size_t width = 1; width < numRuns; width *= 2) {
+        const auto numMerges = (numRuns + 2 * width - 1) / (2 * width);
+        threadPool.parallelFor(numMerges, [&](size_t begin, size_t end) {
+            for (auto merge = begin; merge < end; merge++) {
+                auto first = merge * 2 * width;
+                auto middle = std::min(first + width, numRuns);
+                auto last = std::min(first + 2 * width, numRuns);
+                std::inplace_merge(keys.begin() + runs[first], keys.begin() + runs[middle],
+                                   keys.begin() + runs[last]);
+            }
+        });
+    }
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        indices[i] = keys[i].second;
+    }
+}
+
+size_t GSScene::vertexSize(bool compact, uint32_t shDegree) {
+    const size_t numRestCoefficients = ((shDegree + 1) * (shDegree + 1) - 1) * 3;
+    if (compact) {
+        return offsetof(CompactVertex, shRest) + (numRestCoefficients + 3) / 4 * 4;
+    }
+    return offsetof(Vertex, shs) + (numRestCoefficients + 3) * sizeof(float);
+}
+
+GSScene::VertexStreamRange GSScene::vertexStreamRange(bool compact, uint32_t shDegree, VertexStream stream) {
+    // the position streams leave out w, it is always 1
+    if (compact) {
+        switch (stream) {
+            case POSITION:
+                return {offsetof(CompactVertex, position), sizeof(CompactVertex::position)};
+            case SCALE_OPACITY:
+                return {offsetof(CompactVertex, scaleOpacity), sizeof(CompactVertex::scaleOpacity)};
+            case ROTATION:
+                return {offsetof(CompactVertex, rotation), sizeof(CompactVertex::rotation)};
+            default:
+                return {offsetof(CompactVertex, shDC), vertexSize(compact, shDegree) - offsetof(CompactVertex, shDC)};
+        }
+    }
+    switch (stream) {
+        case POSITION:
+            return {offsetof(Vertex, position), 3 * sizeof(float)};
+        case SCALE_OPACITY:
+            return {offsetof(Vertex, scale_opacity), sizeof(Vertex::scale_opacity)};
+        case ROTATION:
+            return {offsetof(Vertex, rotation), sizeof(Vertex::rotation)};
+        default:
+            return {offsetof(Vertex, shs), vertexSize(compact, shDegree) - offsetof(Vertex, shs)};
+    }
+}
+
+GSScene::CompactVertex GSScene::compactVertex(const Vertex& vertex, uint32_t shDegree) {
+    const int numRestCoefficients = static_cast<int>(((shDegree + 1) * (shDegree + 1) - 1) * 3);
+    CompactVertex compact{};
+    compact.position[0] = vertex.position.x;
+    compact.position[1] = vertex.position.y;
+    compact.position[2] = vertex.position.z;
+    compact.scaleOpacity[0] = glm::packHalf2x16(glm::vec2(vertex.scale_opacity.x, vertex.scale_opacity.y));
+    compact.scaleOpacity[1] = glm::packHalf2x16(glm::vec2(vertex.scale_opacity.z, vertex.scale_opacity.w));
+    compact.rotation[0] = glm::packHalf2x16(glm::vec2(vertex.rotation.x, vertex.rotation.y));
+    compact.rotation[1] = glm::packHalf2x16(glm::vec2(vertex.rotation.z, vertex.rotation.w));
+
+    float restScale = 0.0f;
+    for (int i = 3; i < 3 + numRestCoefficients; i++) {
+        restScale = std::max(restScale, std::abs(vertex.shs[i]));
+    }
+    compact.shDC[0] = glm::packHalf2x16(glm::vec2(vertex.shs[0], vertex.shs[1]));
+    compact.shDC[1] = glm::packHalf2x16(glm::vec2(vertex.shs[2], restScale));
+
+    // quantize against the scale the shader decodes, not the unrounded one
+    restScale = glm::unpackHalf2x16(compact.shDC[1]).y;
+    if (restScale > 0.0f) {
+        for (int i = 0; i < numRestCoefficients; i++) {
+            auto quantized = std::round(vertex.shs[i + 3] / restScale * 127.0f);
+            compact.shRest[i] = static_cast<int8_t>(std::clamp(quantized, -127.0f, 127.0f));
+        }
+    }
+    return compact;
+}
+
+uint64_t GSScene::Options::hash() const {
+    // covers every option that changes the stored data, next to the sizes of the GPU layout
+    uint64_t hash = sizeof(Vertex) | static_cast<uint64_t>(sizeof(Cov3DUpperRight)) << 16;
+    hash |= static_cast<uint64_t>(compactStorage) << 32;
+    hash |= static_cast<uint64_t>(maxShDegree) << 40;
+    hash |= static_cast<uint64_t>(structureOfArrays) << 48;
+    hash |= static_cast<uint64_t>(spatialOrder) << 49;
+    hash |= static_cast<uint64_t>(buildLod) << 50;
+    if (minOpacity > 0.0f || minScale > 0.0f) {
+        hash ^= (static_cast<uint64_t>(std::bit_cast<uint32_t>(minOpacity)) << 32 |
+                 std::bit_cast<uint32_t>(minScale)) * 0x9E3779B97F4A7C15ull;
+    }
+    return hash;
+}
 
 void GSScene::load(const std::shared_ptr<VulkanContext>&context) {
+    prepare(context);
+    stream(context);
+}
+
+void GSScene::prepare(const std::shared_ptr<VulkanContext>&context) {
+    if (options.residencyBudget > 0 && !options.useCache) {
+        spdlog::warn("Using the scene cache anyway, scenes above the residency budget are paged in from it");
+        options.useCache = true;
+    }
+    if (options.useCache) {
+        cache = SceneCache::open(filename, options.hash());
+    }
+
+    if (cache && (!cache->has(SceneCache::Section::METADATA) || !cache->has(SceneCache::Section::CHUNKS))) {
+        spdlog::info("Ignoring incomplete scene cache {}", SceneCache::pathFor(filename));
+        cache.reset();
+    }
+
+    if (cache) {
+        auto metadata = cache->get(SceneCache::Section::METADATA);
+        if (metadata.size() != sizeof(CacheMetadata)) {
+            throw std::runtime_error("Corrupt scene cache: " + SceneCache::pathFor(filename));
+        }
+        auto* cacheMetadata = reinterpret_cast<const CacheMetadata *>(metadata.data());
+        shDegree = cacheMetadata->shDegree;
+        header.numVertices = static_cast<int>(cacheMetadata->numSceneVertices);
+        computeLodLevels();
+        if (shDegree > 3 || numStoredVertices != cache->getNumVertices()) {
+            throw std::runtime_error("Corrupt scene cache: " + SceneCache::pathFor(filename));
+        }
+    } else {
+        std::ifstream plyFile(filename, std::ios::binary);
+        loadPlyHeader(plyFile);
+        plyBodyOffset = static_cast<size_t>(plyFile.tellg());
+        plyFile.close();
+
+        plyLayout = PlyVertexLayout::compile(header);
+        spdlog::debug("PLY vertex stride {} bytes, {} properties, SH degree {}", plyLayout.stride,
+                      header.vertexProperties.size(), plyLayout.shDegree);
+
+        // do not even gather the coefficients that get dropped
+        shDegree = std::min(plyLayout.shDegree, options.maxShDegree);
+        const uint32_t numStoredFloats = offsetof(Vertex, shs) / sizeof(float) + (shDegree + 1) * (shDegree + 1) * 3;
+        std::erase_if(plyLayout.gathers, [numStoredFloats](const PlyVertexLayout::Gather& gather) {
+            return gather.dst >= numStoredFloats;
+        });
+
+        plyMapping = std::make_unique<MappedFile>(filename);
+        if (plyMapping->size() < plyBodyOffset + static_cast<size_t>(header.numVertices) * plyLayout.stride) {
+            throw std::runtime_error("PLY file is truncated: " + filename);
+        }
+
+        numPrunedVertices = 0;
+        plySourceIndices.clear();
+        selectionPending = false;
+        if (options.minOpacity > 0.0f || options.minScale > 0.0f || options.spatialOrder) {
+            selectionPending = options.streamInBackground;
+            if (!selectionPending) {
+                selectVertices();
+            }
+        }
+        computeLodLevels();
+    } else if (!options.prunedPlyPath.empty()) {
+        spdlog::warn("Not writing {}, the scene was loaded from its cache", options.prunedPlyPath);
+    }
+
+    planPaging();
+    numChunkSlots = getNumChunks();
+    createVertexBuffers(context);
+    if (isPaged() && !cache && !options.streamInBackground) {
+        convertToCache(context);
+    }
+
+    cov3DBuffer = createBuffer(context, numVertexSlots * getCov3DSize());
+    chunkBoundsBuffer = createBuffer(context, numChunkSlots * sizeof(ChunkBounds));
+    if (cache && (cache->get(SceneCache::Section::VERTICES).size() != numStoredVertices * getStoredVertexSize() ||
+                  cache->get(SceneCache::Section::COV3D).size() != numStoredVertices * getCov3DSize() ||
+                  cache->get(SceneCache::Section::CHUNKS).size() != getNumChunks() * sizeof(ChunkBounds))) {
+        throw std::runtime_error("Corrupt scene cache: " + SceneCache::pathFor(filename));
+    }
+    createPageBuffers(context);
+    if (hasLod()) {
+        // the padding between the levels is never written and has to read as transparent
+        auto commandBuffer = context->beginOneTimeCommandBuffer();
+        for (auto& stream: storageStreams) {
+            commandBuffer->fillBuffer(stream.buffer->buffer, 0, VK_WHOLE_SIZE, 0);
+        }
+        context->endOneTimeCommandBuffer(std::move(commandBuffer), VulkanContext::Queue::COMPUTE);
+        spdlog::info("Reserving {} slots for proxy splats in {} LOD levels", numStoredVertices - header.numVertices,
+                     lodLevels.size() - 1);
+    }
+    spdlog::info("Storing {} splats with SH degree {} in {} bytes each ({} MB, {} buffers)", numStoredVertices,
+                 shDegree, getStoredVertexSize() + getCov3DSize(),
+                 numStoredVertices * (getStoredVertexSize() + getCov3DSize()) / (1024 * 1024),
+                 storageStreams.size() + 1);
+    if (isPaged()) {
+        spdlog::info("Paging {} pages of {} splats through {} resident ones ({} MB)", getNumPages(), PAGE_SIZE,
+                     numPageSlots, numVertexSlots * (getStoredVertexSize() + getCov3DSize()) / (1024 * 1024));
+    }
+    if (numPrunedVertices > 0) {
+        spdlog::info("Pruning saved {} MB of splat storage", numPrunedVertices * (getStoredVertexSize() + getCov3DSize())
+                                                             / (1024 * 1024));
+    }
+    if (!cache) {
+        createPrecomputeCov3DPipeline(context);
+    }
+    numLoadedVertices = 0;
+}
+
+void GSScene::stream(const std::shared_ptr<VulkanContext>&context) {
+    if (selectionPending) {
+        // the buffers stay sized for all splats of the file, the kept ones are laid out from their start. The
+        // renderer only reads the layout once it saw vertices loaded.
+        selectVertices();
+        computeLodLevels();
+        selectionPending = false;
+    }
+    if (isPaged() && !cache) {
+        convertToCache(context);
+        if (loadingCancelled) {
+            return;
+        }
+    }
+    if (isPaged()) {
+        streamPages(context);
+        cache.reset();
+    } else if (cache) {
+        streamFromCache(context);
+        cache.reset();
+    } else {
+        streamFromPly(context);
+        plyMapping.reset();
+    }
+}
+
+void GSScene::convertToCache(const std::shared_ptr<VulkanContext>& context) {
+    // the pages are read from the cache, so it is written first without going through the GPU
+    spdlog::info("Converting {} into its cache to page it from", filename);
+    streamFromPly(context);
+    plyMapping.reset();
+    if (loadingCancelled) {
+        return;
+    }
+    cache = SceneCache::open(filename, options.hash());
+    if (!cache) {
+        throw std::runtime_error("Could not create the scene cache to page " + filename + " from");
+    }
+}
+
+void GSScene::streamFromPly(const std::shared_ptr<VulkanContext>&context) {
     auto startTime = std::chrono::high_resolution_clock::now();
 
-    std::ifstream plyFile(filename, std::ios::binary);
-    loadPlyHeader(plyFile);
-
-    vertexBuffer = createBuffer(context, header.numVertices * sizeof(Vertex));
-    auto vertexStagingBuffer = Buffer::staging(context, header.numVertices * sizeof(Vertex));
-    auto* verteces = static_cast<Vertex *>(vertexStagingBuffer->allocation_info.pMappedData);
-
-    for (auto i = 0; i < header.numVertices; i++) {
-        static_assert(sizeof(VertexStorage) == 62 * sizeof(float));
-        assert(plyFile.is_open());
-        assert(!plyFile.eof());
-        VertexStorage vertexStorage;
-        plyFile.read(reinterpret_cast<char *>(&vertexStorage), sizeof(VertexStorage));
-        verteces[i].position = glm::vec4(vertexStorage.position, 1.0f);
-        // verteces[i].normal = glm::vec4(vertexStorage.normal, 0.0f);
-        verteces[i].scale_opacity = glm::vec4(glm::exp(vertexStorage.scale), 1.0f / (1.0f + std::exp(-vertexStorage.opacity)));
-        verteces[i].rotation = normalize(vertexStorage.rotation);
-        // memcpy(verteces[i].shs, vertexStorage.shs, 48 * sizeof(float));
-        verteces[i].shs[0] = vertexStorage.shs[0];
-        verteces[i].shs[1] = vertexStorage.shs[1];
-        verteces[i].shs[2] = vertexStorage.shs[2];
-        auto SH_N = 16;
-        for (auto j = 1; j < SH_N; j++) {
-            verteces[i].shs[j * 3 + 0] = vertexStorage.shs[(j - 1) + 3];
-            verteces[i].shs[j * 3 + 1] = vertexStorage.shs[(j - 1) + SH_N + 2];
-            verteces[i].shs[j * 3 + 2] = vertexStorage.shs[(j - 1) + SH_N * 2 + 1];
-        }
-        assert(vertexStorage.normal.x == 0.0f);
-        assert(vertexStorage.normal.y == 0.0f);
-        assert(vertexStorage.normal.z == 0.0f);
-    }
-
-    vertexBuffer->uploadFrom(vertexStagingBuffer);
+    const auto numVertices = static_cast<size_t>(header.numVertices);
+    const auto& layout = plyLayout;
+    const auto* body = plyMapping->data() + plyBodyOffset;
+    auto cacheWriter = options.useCache ? createCacheWriter() : nullptr;
+
+    // each chunk is converted into its own slice of the ring while the GPU still copies the previous ones
+    ThreadPool threadPool;
+    StagingRing stagingRing(context);
+    const auto streams = getStorageStreamRanges();
+    // slices hold whole splat chunks followed by their bounds, and their covariances if those are computed here
+    const size_t cov3DSize = isPaged() ? getCov3DSize() : 0;
+    const size_t verticesPerSlice = stagingRing.getSliceSize() /
+                                    (CHUNK_SIZE * (getStoredVertexSize() + cov3DSize) + sizeof(ChunkBounds)) *
+                                    CHUNK_SIZE;
+    // the staging memory is write-combined, so the chunks the cache gets are converted on the CPU side first
+    std::vector<char> cacheSlice(cacheWriter ? stagingRing.getSliceSize() : 0);
+    std::chrono::high_resolution_clock::duration ioTime{};
+    std::chrono::high_resolution_clock::duration conversionTime{};
+
+    // the scene splats are merged into the first proxy level while they are converted anyway
+    std::vector<Vertex> proxies(hasLod() ? lodLevels[1].numVertices : 0);
+    std::vector<ChunkBounds> sceneBounds(hasLod() ? lodLevels[0].numChunks : 0);
+
+    for (size_t first = 0; first < numVertices && !loadingCancelled; first += verticesPerSlice) {
+        auto count = std::min(verticesPerSlice, numVertices - first);
+        const auto* sourceIndices = plySourceIndices.empty() ? nullptr : plySourceIndices.data() + first;
+        auto& slice = stagingRing.acquire();
+        auto* vertices = cacheWriter ? cacheSlice.data() : slice.data;
+
+        auto chunkStartTime = std::chrono::high_resolution_clock::now();
+        // fault the chunk in from all workers so that the conversion below runs from memory, selectVertices()
+        // already went over the whole body otherwise
+        if (!sourceIndices) {
+            threadPool.parallelFor(count * layout.stride, [&](size_t begin, size_t end) {
+                plyMapping->prefetch(plyBodyOffset + first * layout.stride + begin, end - begin);
+            });
+        }
+        auto chunkIoTime = std::chrono::high_resolution_clock::now();
+
+        const auto firstChunk = first / CHUNK_SIZE;
+        const auto numChunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        auto* bounds = vertices + count * getStoredVertexSize();
+        auto* cov3Ds = isPaged() ? bounds + numChunks * sizeof(ChunkBounds) : nullptr;
+        threadPool.parallelFor(numChunks, [&](size_t begin, size_t end) {
+            for (auto chunk = begin; chunk < end; chunk++) {
+                auto chunkBounds = convertVertices(layout, sourceIndices ? body : body + first * layout.stride,
+                                                   sourceIndices, chunk * CHUNK_SIZE,
+                                                   std::min((chunk + 1) * CHUNK_SIZE, count), options.compactStorage,
+                                                   shDegree, streams, count, vertices,
+                                                   hasLod() ? proxies.data() + first / LOD_BRANCHING : nullptr,
+                                                   cov3Ds);
+                chunkBounds.parent = parentChunk(0, firstChunk + chunk);
+                if (hasLod()) {
+                    sceneBounds[firstChunk + chunk] = chunkBounds;
+                }
+                memcpy(bounds + chunk * sizeof(ChunkBounds), &chunkBounds, sizeof(ChunkBounds));
+            }
+        });
+        if (vertices != slice.data) {
+            memcpy(slice.data, vertices, count * (getStoredVertexSize() + cov3DSize) + numChunks * sizeof(ChunkBounds));
+        }
+        auto chunkConversionTime = std::chrono::high_resolution_clock::now();
+        ioTime += chunkIoTime - chunkStartTime;
+        conversionTime += chunkConversionTime - chunkIoTime;
+
+        if (isPaged()) {
+            // only converted into the cache, the slice just goes back to the ring
+            stagingRing.submit(slice);
+        } else {
+            uploadVertices(stagingRing, slice, 0, first, count);
+            stagingRing.copy(slice, count * getStoredVertexSize(), chunkBoundsBuffer,
+                             firstChunk * sizeof(ChunkBounds), numChunks * sizeof(ChunkBounds));
+            vertexUploadBarrier(context).build(slice.commandBuffer.get(), vk::PipelineStageFlagBits::eTransfer,
+                                               vk::PipelineStageFlagBits::eComputeShader);
+            recordPrecomputeCov3D(context, slice.commandBuffer, static_cast<uint32_t>(first),
+                                  static_cast<uint32_t>(count));
+            stagingRing.submit(slice, [this, loaded = static_cast<uint32_t>(first + count)] {
+                numLoadedVertices.store(loaded, std::memory_order_release);
+            });
+        }
+
+        writeCacheSlice(cacheWriter, vertices, bounds, cov3Ds, first, count);
+        numConvertedVertices.store(static_cast<uint32_t>(first + count), std::memory_order_relaxed);
+    }
+    if (hasLod() && !loadingCancelled) {
+        streamLodLevels(context, threadPool, stagingRing, cacheWriter, std::move(proxies), std::move(sceneBounds));
+    }
+    stagingRing.flush();
+
+    if (loadingCancelled) {
+        spdlog::info("Loading {} cancelled after {} of {} splats", filename, numLoadedVertices.load(),
+                     numStoredVertices);
+        return;
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    spdlog::info("Loaded {} in {}ms (I/O {}ms, conversion {}ms on {} threads, waiting for uploads {}ms, {} MB staging)",
+                 filename,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count(),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(ioTime).count(),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(conversionTime).count(),
+                 threadPool.size(),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(stagingRing.waitTime).count(),
+                 StagingRing::DEFAULT_SIZE / (1024 * 1024));
+
+    if (cacheWriter) {
+        commitCache(context, *cacheWriter);
+    }
+
+    if (!options.prunedPlyPath.empty()) {
+        try {
+            writePrunedPly();
+        } catch (const std::exception& e) {
+            spdlog::warn("Could not write pruned scene: {}", e.what());
+        }
+    }
+}
+
+void GSScene::streamLodLevels(const std::shared_ptr<VulkanContext>& context, ThreadPool& threadPool,
+                              StagingRing& stagingRing, std::unique_ptr<SceneCache::Writer>& cacheWriter,
+                              std::vector<Vertex> vertices, std::vector<ChunkBounds> childBounds) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    const auto streams = getStorageStreamRanges();
+    const size_t cov3DSize = isPaged() ? getCov3DSize() : 0;
+    const size_t verticesPerSlice = stagingRing.getSliceSize() /
+                                    (CHUNK_SIZE * (getStoredVertexSize() + cov3DSize) + sizeof(ChunkBounds)) *
+                                    CHUNK_SIZE;
+    std::vector<char> cacheSlice(cacheWriter ? stagingRing.getSliceSize() : 0);
+
+    for (size_t level = 1; level < lodLevels.size() && !loadingCancelled; level++) {
+        const auto& lod = lodLevels[level];
+        const auto firstLevelChunk = lod.firstVertex / CHUNK_SIZE;
+
+        // a chunk contains its children, so that a parent is never further away from the camera than they are
+        std::vector<ChunkBounds> bounds(lod.numChunks);
+        threadPool.parallelFor(lod.numChunks, [&](size_t begin, size_t end) {
+            for (auto chunk = begin; chunk < end; chunk++) {
+                auto chunkBounds = emptyChunkBounds();
+                for (auto child = chunk * LOD_BRANCHING;
+                     child < std::min((chunk + 1) * LOD_BRANCHING, childBounds.size()); child++) {
+                    chunkBounds.min = glm::min(chunkBounds.min, childBounds[child].min);
+                    chunkBounds.max = glm::max(chunkBounds.max, childBounds[child].max);
+                    chunkBounds.error = std::max(chunkBounds.error, childBounds[child].error);
+                }
+                for (auto i = chunk * CHUNK_SIZE; i < std::min((chunk + 1) * CHUNK_SIZE, vertices.size()); i++) {
+                    growChunkBounds(chunkBounds, vertices[i]);
+                    chunkBounds.error = std::max(chunkBounds.error, maxScale(vertices[i]));
+                }
+                chunkBounds.parent = parentChunk(level, chunk);
+                bounds[chunk] = chunkBounds;
+            }
+        });
+
+        for (size_t first = 0; first < lod.numVertices && !loadingCancelled; first += verticesPerSlice) {
+            auto count = std::min(verticesPerSlice, lod.numVertices - first);
+            auto& slice = stagingRing.acquire();
+            auto* stored = cacheWriter ? cacheSlice.data() : slice.data;
+            const auto firstChunk = first / CHUNK_SIZE;
+            const auto numChunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            auto* chunkBounds = stored + count * getStoredVertexSize();
+            auto* cov3Ds = isPaged() ? chunkBounds + numChunks * sizeof(ChunkBounds) : nullptr;
+            threadPool.parallelFor(count, [&](size_t begin, size_t end) {
+                for (auto i = begin; i < end; i++) {
+                    storeVertex(vertices[first + i], options.compactStorage, shDegree, streams, count, i, stored);
+                    if (cov3Ds) {
+                        storeCov3D(vertices[first + i], options.compactStorage, cov3Ds + i * cov3DSize);
+                    }
+                }
+            });
+            memcpy(chunkBounds, bounds.data() + firstChunk, numChunks * sizeof(ChunkBounds));
+            if (stored != slice.data) {
+                memcpy(slice.data, stored,
+                       count * (getStoredVertexSize() + cov3DSize) + numChunks * sizeof(ChunkBounds));
+            }
+
+            const auto firstVertex = lod.firstVertex + first;
+            if (isPaged()) {
+                stagingRing.submit(slice);
+            } else {
+                uploadVertices(stagingRing, slice, 0, firstVertex, count);
+                stagingRing.copy(slice, count * getStoredVertexSize(), chunkBoundsBuffer,
+                                 (firstLevelChunk + firstChunk) * sizeof(ChunkBounds),
+                                 numChunks * sizeof(ChunkBounds));
+                vertexUploadBarrier(context).build(slice.commandBuffer.get(), vk::PipelineStageFlagBits::eTransfer,
+                                                   vk::PipelineStageFlagBits::eComputeShader);
+                recordPrecomputeCov3D(context, slice.commandBuffer, static_cast<uint32_t>(firstVertex),
+                                      static_cast<uint32_t>(count));
+                stagingRing.submit(slice, [this, loaded = static_cast<uint32_t>(firstVertex + count)] {
+                    numLoadedVertices.store(loaded, std::memory_order_release);
+                });
+            }
+            writeCacheSlice(cacheWriter, stored, chunkBounds, cov3Ds, firstVertex, count);
+        }
+
+        if (level + 1 < lodLevels.size()) {
+            std::vector<Vertex> parents(lodLevels[level + 1].numVertices);
+            threadPool.parallelFor(parents.size(), [&](size_t begin, size_t end) {
+                for (auto i = begin; i < end; i++) {
+                    parents[i] = mergeVertices(vertices.data() + i * LOD_BRANCHING,
+                                               std::min<size_t>(LOD_BRANCHING, vertices.size() - i * LOD_BRANCHING));
+                }
+            });
+            vertices = std::move(parents);
+        }
+        childBounds = std::move(bounds);
+    }
 
     auto endTime = std::chrono::high_resolution_clock::now();
-    spdlog::info("Loaded {} in {}ms", filename,
+    spdlog::info("Built {} LOD levels in {}ms", lodLevels.size() - 1,
                  std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
+}
+
+void GSScene::selectVertices() {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    constexpr uint32_t positionOffset = offsetof(Vertex, position) / sizeof(float);
+    constexpr uint32_t scaleOffset = offsetof(Vertex, scale_opacity) / sizeof(float);
+    const bool prune = options.minOpacity > 0.0f || options.minScale > 0.0f;
+    const bool sort = options.spatialOrder;
+
+    // pruning only needs scale and opacity, the ordering only positions
+    PlyVertexLayout selectLayout = plyLayout;
+    std::erase_if(selectLayout.gathers, [&](const PlyVertexLayout::Gather& gather) {
+        bool isPosition = gather.dst >= positionOffset && gather.dst < positionOffset + 3;
+        bool isScaleOpacity = gather.dst >= scaleOffset && gather.dst < scaleOffset + 4;
+        return !(prune && isScaleOpacity) && !(sort && isPosition);
+    });
+
+    const auto numSourceVertices = static_cast<size_t>(header.numVertices);
+    const auto* body = plyMapping->data() + plyBodyOffset;
+    const auto defaultVertex = defaultPlyVertex();
+    std::vector<uint8_t> keep(numSourceVertices, 1);
+    std::vector<glm::vec3> positions(sort ? numSourceVertices : 0);
+    ThreadPool threadPool;
+    threadPool.parallelFor(numSourceVertices, [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; i++) {
+            auto vertex = readPlyVertex(selectLayout, defaultVertex, body + i * selectLayout.stride);
+            if (prune) {
+                auto maxScale = std::max(std::max(vertex.scale_opacity.x, vertex.scale_opacity.y),
+                                         vertex.scale_opacity.z);
+                keep[i] = vertex.scale_opacity.w >= options.minOpacity && maxScale >= options.minScale;
+            }
+            if (sort) {
+                positions[i] = glm::vec3(vertex.position);
+            }
+        }
+    });
+
+    plySourceIndices.clear();
+    for (size_t i = 0; i < numSourceVertices; i++) {
+        if (keep[i]) {
+            plySourceIndices.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    if (plySourceIndices.empty()) {
+        throw std::runtime_error("Pruning removed all splats of " + filename);
+    }
+
+    numPrunedVertices = numSourceVertices - plySourceIndices.size();
+    header.numVertices = static_cast<int>(plySourceIndices.size());
+    auto pruneTime = std::chrono::high_resolution_clock::now();
+    if (prune) {
+        spdlog::info("Pruned {} of {} splats ({:.1f}%) below opacity {} or scale {} in {}ms", numPrunedVertices,
+                     numSourceVertices, 100.0 * numPrunedVertices / numSourceVertices, options.minOpacity,
+                     options.minScale, std::chrono::duration_cast<std::chrono::milliseconds>(pruneTime - startTime).count());
+    }
+
+    if (sort) {
+        sortMortonOrder(threadPool, positions, plySourceIndices);
+        auto endTime = std::chrono::high_resolution_clock::now();
+        spdlog::info("Sorted {} splats along a Morton curve in {}ms", plySourceIndices.size(),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(endTime - pruneTime).count());
+    }
+}
 
-    precomputeCov3D(context);
+void GSScene::writePrunedPly() const {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::ofstream file(options.prunedPlyPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Could not create " + options.prunedPlyPath);
+    }
+
+    // same header with the new vertex count, other elements are dropped
+    std::istringstream headerText(std::string(plyMapping->data(), plyBodyOffset));
+    std::string line;
+    bool skipElement = false;
+    while (std::getline(headerText, line)) {
+        std::istringstream iss(line);
+        std::string token;
+        iss >> token;
+        if (token == "element") {
+            std::string element;
+            iss >> element;
+            skipElement = element != "vertex";
+            if (!skipElement) {
+                file << "element vertex " << header.numVertices << "\n";
+                continue;
+            }
+        } else if (token == "end_header") {
+            skipElement = false;
+        }
+        if (!skipElement) {
+            file << line << "\n";
+        }
+    }
+
+    // the records are copied unchanged, so the file keeps everything the loader dropped
+    const auto* body = plyMapping->data() + plyBodyOffset;
+    const auto stride = plyLayout.stride;
+    const auto numVertices = static_cast<size_t>(header.numVertices);
+    std::vector<char> block;
+    constexpr size_t verticesPerBlock = 64 * 1024;
+    for (size_t first = 0; first < numVertices; first += verticesPerBlock) {
+        auto count = std::min(verticesPerBlock, numVertices - first);
+        block.resize(count * stride);
+        for (size_t i = 0; i < count; i++) {
+            auto record = plySourceIndices.empty() ? first + i : plySourceIndices[first + i];
+            memcpy(block.data() + i * stride, body + record * stride, stride);
+        }
+        file.write(block.data(), static_cast<std::streamsize>(block.size()));
+    }
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Could not write " + options.prunedPlyPath);
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    spdlog::info("Wrote {} splats to {} in {}ms", numVertices, options.prunedPlyPath,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
+}
+
+void GSScene::streamFromCache(const std::shared_ptr<VulkanContext>&context) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    const auto numVertices = static_cast<size_t>(numStoredVertices);
+    auto vertices = cache->get(SceneCache::Section::VERTICES);
+    auto cov3Ds = cache->get(SceneCache::Section::COV3D);
+    auto chunks = cache->get(SceneCache::Section::CHUNKS);
+
+    // the cache already holds the GPU layout, the copy into the ring only pulls the pages in. A slice carries the
+    // vertices, covariances and chunk bounds of the same range so that every completed slice extends the drawable
+    // prefix.
+    ThreadPool threadPool;
+    StagingRing stagingRing(context);
+    const auto streams = getStorageStreamRanges();
+    const size_t verticesPerSlice = stagingRing.getSliceSize() /
+                                    (CHUNK_SIZE * (getStoredVertexSize() + getCov3DSize()) + sizeof(ChunkBounds)) *
+                                    CHUNK_SIZE;
+
+    for (size_t first = 0; first < numVertices && !loadingCancelled; first += verticesPerSlice) {
+        auto count = std::min(verticesPerSlice, numVertices - first);
+        auto& slice = stagingRing.acquire();
+        const auto cov3DOffset = count * getStoredVertexSize();
+        const auto boundsOffset = cov3DOffset + count * getCov3DSize();
+        const auto firstChunk = first / CHUNK_SIZE;
+        const auto numChunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        memcpy(slice.data + boundsOffset, chunks.data() + firstChunk * sizeof(ChunkBounds),
+               numChunks * sizeof(ChunkBounds));
+        threadPool.parallelFor(count, [&](size_t begin, size_t end) {
+            size_t streamOffset = 0;
+            for (auto& stream: streams) {
+                memcpy(slice.data + streamOffset * count + begin * stream.size,
+                       vertices.data() + streamOffset * numVertices + (first + begin) * stream.size,
+                       (end - begin) * stream.size);
+                streamOffset += stream.size;
+            }
+            memcpy(slice.data + cov3DOffset + begin * getCov3DSize(),
+                   cov3Ds.data() + (first + begin) * getCov3DSize(),
+                   (end - begin) * getCov3DSize());
+        });
+        uploadVertices(stagingRing, slice, 0, first, count);
+        stagingRing.copy(slice, cov3DOffset, cov3DBuffer, first * getCov3DSize(),
+                         count * getCov3DSize());
+        stagingRing.copy(slice, boundsOffset, chunkBoundsBuffer, firstChunk * sizeof(ChunkBounds),
+                         numChunks * sizeof(ChunkBounds));
+
+        vertexUploadBarrier(context)
+                .addBufferBarrier(cov3DBuffer, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead)
+                .build(slice.commandBuffer.get(), vk::PipelineStageFlagBits::eTransfer,
+                       vk::PipelineStageFlagBits::eComputeShader);
+
+        stagingRing.submit(slice, [this, loaded = static_cast<uint32_t>(first + count)] {
+            numLoadedVertices.store(loaded, std::memory_order_release);
+        });
+    }
+    stagingRing.flush();
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    spdlog::info("Loaded {} from {} in {}ms (waiting for uploads {}ms)", filename, SceneCache::pathFor(filename),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count(),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(stagingRing.waitTime).count());
+}
+
+std::unique_ptr<SceneCache::Writer> GSScene::createCacheWriter() const {
+    try {
+        auto writer = std::make_unique<SceneCache::Writer>(filename, options.hash(), numStoredVertices);
+        writer->reserve(SceneCache::Section::VERTICES, numStoredVertices * getStoredVertexSize());
+        writer->reserve(SceneCache::Section::COV3D, numStoredVertices * getCov3DSize());
+        writer->reserve(SceneCache::Section::METADATA, sizeof(CacheMetadata));
+        writer->reserve(SceneCache::Section::CHUNKS, getNumChunks() * sizeof(ChunkBounds));
+        CacheMetadata metadata{shDegree, static_cast<uint32_t>(header.numVertices)};
+        writer->write(SceneCache::Section::METADATA, 0, &metadata, sizeof(CacheMetadata));
+        return writer;
+    } catch (const std::exception& e) {
+        spdlog::warn("Could not write scene cache: {}", e.what());
+        return nullptr;
+    }
+}
+
+void GSScene::writeCacheSlice(std::unique_ptr<SceneCache::Writer>& writer, const char* vertices, const char* bounds,
+                              const char* cov3Ds, size_t first, size_t count) const {
+    if (!writer) {
+        return;
+    }
+    try {
+        // the section holds each stream of all vertices in turn, like the slice does for its vertices
+        size_t streamOffset = 0;
+        for (auto& stream: storageStreams) {
+            writer->write(SceneCache::Section::VERTICES, streamOffset * numStoredVertices + first * stream.range.size,
+                          vertices + streamOffset * count, count * stream.range.size);
+            streamOffset += stream.range.size;
+        }
+        writer->write(SceneCache::Section::CHUNKS, first / CHUNK_SIZE * sizeof(ChunkBounds), bounds,
+                      (count + CHUNK_SIZE - 1) / CHUNK_SIZE * sizeof(ChunkBounds));
+        if (cov3Ds) {
+            writer->write(SceneCache::Section::COV3D, first * getCov3DSize(), cov3Ds, count * getCov3DSize());
+        }
+    } catch (const std::exception& e) {
+        spdlog::warn("Could not write scene cache: {}", e.what());
+        writer.reset();
+    }
+}
+
+void GSScene::commitCache(const std::shared_ptr<VulkanContext>& context, SceneCache::Writer& writer) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    try {
+        // read the covariances back through the ring, each slice goes to the file once its copy completed. Paged
+        // scenes wrote them along with the vertices.
+        const vk::DeviceSize cov3DSize = isPaged() ? 0 : numStoredVertices * getCov3DSize();
+        if (cov3DSize > 0) {
+            StagingRing stagingRing(context, StagingRing::Direction::READBACK);
+            for (vk::DeviceSize offset = 0; offset < cov3DSize; offset += stagingRing.getSliceSize()) {
+                auto size = std::min(stagingRing.getSliceSize(), cov3DSize - offset);
+                auto& slice = stagingRing.acquire();
+                stagingRing.readback(slice, cov3DBuffer, offset, 0, size);
+                stagingRing.submit(slice, [&writer, &slice, offset, size] {
+                    writer.write(SceneCache::Section::COV3D, offset, slice.data, size);
+                });
+            }
+            stagingRing.flush();
+        }
+        writer.commit();
+    } catch (const std::exception& e) {
+        spdlog::warn("Could not write scene cache: {}", e.what());
+        return;
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    spdlog::info("Wrote {} in {}ms", SceneCache::pathFor(filename),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count());
 }
 
 void GSScene::loadTestScene(const std::shared_ptr<VulkanContext>&context) {
     int testObects = 1;
     header.numVertices = testObects;
-    vertexBuffer = createBuffer(context, testObects * sizeof(Vertex));
-    auto vertexStagingBuffer = Buffer::staging(context, testObects * sizeof(Vertex));
-    auto* verteces = static_cast<Vertex *>(vertexStagingBuffer->allocation_info.pMappedData);
+    shDegree = 3;
+    computeLodLevels();
+    numVertexSlots = numStoredVertices;
+    numChunkSlots = getNumChunks();
+    createVertexBuffers(context);
+    std::vector<Vertex> verteces(testObects);
 
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -91,9 +1189,29 @@ void GSScene::loadTestScene(const std::shared_ptr<VulkanContext>&context) {
         }
     }
 
-    vertexBuffer->uploadFrom(vertexStagingBuffer);
+    cov3DBuffer = createBuffer(context, testObects * getCov3DSize());
+    chunkBoundsBuffer = createBuffer(context, getNumChunks() * sizeof(ChunkBounds));
+    createPageBuffers(context);
+    createPrecomputeCov3DPipeline(context);
 
-    precomputeCov3D(context);
+    StagingRing stagingRing(context);
+    auto& slice = stagingRing.acquire();
+    const auto streams = getStorageStreamRanges();
+    std::vector<ChunkBounds> bounds(getNumChunks(), emptyChunkBounds());
+    for (auto i = 0; i < testObects; i++) {
+        storeVertex(verteces[i], options.compactStorage, shDegree, streams, testObects, i, slice.data);
+        growChunkBounds(bounds[i / CHUNK_SIZE], verteces[i]);
+    }
+    const auto boundsOffset = testObects * getStoredVertexSize();
+    memcpy(slice.data + boundsOffset, bounds.data(), bounds.size() * sizeof(ChunkBounds));
+    uploadVertices(stagingRing, slice, 0, 0, testObects);
+    stagingRing.copy(slice, boundsOffset, chunkBoundsBuffer, 0, bounds.size() * sizeof(ChunkBounds));
+    vertexUploadBarrier(context).build(slice.commandBuffer.get(), vk::PipelineStageFlagBits::eTransfer,
+                                       vk::PipelineStageFlagBits::eComputeShader);
+    recordPrecomputeCov3D(context, slice.commandBuffer, 0, testObects);
+    stagingRing.submit(slice);
+    stagingRing.flush();
+    numLoadedVertices = testObects;
 }
 
 void GSScene::loadPlyHeader(std::ifstream&plyFile) {
@@ -103,6 +1221,11 @@ void GSScene::loadPlyHeader(std::ifstream&plyFile) {
 
     std::string line;
     bool headerEnd = false;
+    std::string currentElement;
+    std::vector<std::string> elements;
+    header.numVertices = 0;
+    header.numFaces = 0;
+    header.vertexStride = 0;
 
     while (std::getline(plyFile, line)) {
         std::istringstream iss(line);
@@ -117,23 +1240,46 @@ void GSScene::loadPlyHeader(std::ifstream&plyFile) {
             iss >> header.format;
         }
         else if (token == "element") {
-            iss >> token;
+            iss >> currentElement;
+            elements.push_back(currentElement);
 
-            if (token == "vertex") {
+            if (currentElement == "vertex") {
                 iss >> header.numVertices;
             }
-            else if (token == "face") {
+            else if (currentElement == "face") {
                 iss >> header.numFaces;
             }
         }
         else if (token == "property") {
             PlyProperty property;
-            iss >> property.type >> property.name;
+            iss >> property.type;
+
+            if (property.type == "list") {
+                if (currentElement == "vertex") {
+                    throw std::runtime_error("List properties on vertices are not supported: " + filename);
+                }
+                std::string countType, itemType;
+                iss >> countType >> itemType >> property.name;
+                property.scalarType = PlyScalarType::UINT8;
+                property.offset = 0;
+                header.faceProperties.push_back(property);
+                continue;
+            }
 
-            if (header.vertexProperties.size() < static_cast<size_t>(header.numVertices)) {
+            iss >> property.name;
+            auto scalarType = parsePlyScalarType(property.type);
+            if (!scalarType.has_value()) {
+                throw std::runtime_error("Unknown PLY property type " + property.type + " in " + filename);
+            }
+            property.scalarType = scalarType.value();
+
+            if (currentElement == "vertex") {
+                property.offset = header.vertexStride;
+                header.vertexStride += plyScalarSize(property.scalarType);
                 header.vertexProperties.push_back(property);
             }
             else {
+                property.offset = 0;
                 header.faceProperties.push_back(property);
             }
         }
@@ -146,39 +1292,347 @@ void GSScene::loadPlyHeader(std::ifstream&plyFile) {
     if (!headerEnd) {
         throw std::runtime_error("Could not find end of header");
     }
+
+    if (header.format != "binary_little_endian") {
+        throw std::runtime_error("Unsupported PLY format " + header.format + " in " + filename);
+    }
+
+    // the body is read straight from the mapped file, so the vertices have to come first
+    if (elements.empty() || elements[0] != "vertex") {
+        throw std::runtime_error("PLY file does not start with a vertex element: " + filename);
+    }
+}
+
+void GSScene::computeLodLevels() {
+    const auto numSceneVertices = static_cast<uint32_t>(header.numVertices);
+    lodLevels = {{0, numSceneVertices, (numSceneVertices + CHUNK_SIZE - 1) / CHUNK_SIZE}};
+    if (!options.buildLod) {
+        numStoredVertices = numSceneVertices;
+        return;
+    }
+
+    // merge until a single chunk covers the whole scene
+    while (lodLevels.back().numChunks > 1) {
+        auto below = lodLevels.back();
+        auto numVertices = (below.numVertices + LOD_BRANCHING - 1) / LOD_BRANCHING;
+        lodLevels.push_back({below.firstVertex + below.numChunks * CHUNK_SIZE, numVertices,
+                             (numVertices + CHUNK_SIZE - 1) / CHUNK_SIZE});
+    }
+    numStoredVertices = lodLevels.back().firstVertex + lodLevels.back().numVertices;
+}
+
+uint32_t GSScene::parentChunk(size_t level, size_t chunk) const {
+    if (level + 1 >= lodLevels.size()) {
+        return NO_PARENT_CHUNK;
+    }
+    return lodLevels[level + 1].firstVertex / CHUNK_SIZE + static_cast<uint32_t>(chunk / LOD_BRANCHING);
+}
+
+void GSScene::planPaging() {
+    numVertexSlots = numStoredVertices;
+    numPageSlots = 0;
+    if (options.residencyBudget == 0) {
+        return;
+    }
+
+    // the vertex buffers are sized by the outcome, so the streams are not known yet
+    size_t storedVertexSize = getVertexSize();
+    if (options.structureOfArrays) {
+        storedVertexSize = 0;
+        for (int stream = 0; stream < NUM_VERTEX_STREAMS; stream++) {
+            storedVertexSize += vertexStreamRange(options.compactStorage, shDegree,
+                                                  static_cast<VertexStream>(stream)).size;
+        }
+    }
+    const auto pageBytes = static_cast<uint64_t>(PAGE_SIZE) * (storedVertexSize + getCov3DSize());
+    const auto numSlots = options.residencyBudget / pageBytes;
+    if (numSlots >= getNumPages()) {
+        spdlog::info("Scene fits into the residency budget of {} MB", options.residencyBudget / (1024 * 1024));
+        return;
+    }
+    if (numSlots == 0) {
+        throw std::runtime_error("Residency budget is smaller than one page of " + std::to_string(pageBytes) +
+                                 " bytes");
+    }
+    numPageSlots = static_cast<uint32_t>(numSlots);
+    numVertexSlots = numPageSlots * PAGE_SIZE;
+}
+
+void GSScene::createPageBuffers(const std::shared_ptr<VulkanContext>& context) {
+    const auto numEntries = isPaged() ? getNumPages() : 1;
+    pageTableBuffer = createBuffer(context, numEntries * sizeof(uint32_t));
+    pageRequestBuffer = Buffer::feedback(context, numEntries * sizeof(uint32_t));
+    memset(pageRequestBuffer->allocation_info.pMappedData, 0, numEntries * sizeof(uint32_t));
+    vmaFlushAllocation(context->allocator, pageRequestBuffer->allocation, 0, VK_WHOLE_SIZE);
+
+    auto commandBuffer = context->beginOneTimeCommandBuffer();
+    commandBuffer->fillBuffer(pageTableBuffer->buffer, 0, VK_WHOLE_SIZE, NOT_RESIDENT);
+    context->endOneTimeCommandBuffer(std::move(commandBuffer), VulkanContext::Queue::COMPUTE);
+}
+
+void GSScene::streamPages(const std::shared_ptr<VulkanContext>& context) {
+    StagingRing stagingRing(context);
+
+    // the bounds of all chunks stay resident, the renderer culls against them to request pages
+    auto chunks = cache->get(SceneCache::Section::CHUNKS);
+    // the loader orders the pages by their distance to the camera
+    pageBounds.assign(getNumPages(), emptyChunkBounds());
+    for (uint32_t chunk = 0; chunk < getNumChunks(); chunk++) {
+        ChunkBounds bounds;
+        memcpy(&bounds, chunks.data() + chunk * sizeof(ChunkBounds), sizeof(ChunkBounds));
+        auto& page = pageBounds[chunk / PAGE_CHUNKS];
+        page.min = glm::min(page.min, bounds.min);
+        page.max = glm::max(page.max, bounds.max);
+    }
+    for (vk::DeviceSize offset = 0; offset < chunks.size(); offset += stagingRing.getSliceSize()) {
+        auto size = std::min(stagingRing.getSliceSize(), chunks.size() - offset);
+        auto& slice = stagingRing.acquire();
+        memcpy(slice.data, chunks.data() + offset, size);
+        stagingRing.copy(slice, 0, chunkBoundsBuffer, offset, size);
+        Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+                .addBufferBarrier(chunkBoundsBuffer, vk::AccessFlagBits::eTransferWrite,
+                                  vk::AccessFlagBits::eShaderRead)
+                .build(slice.commandBuffer.get(), vk::PipelineStageFlagBits::eTransfer,
+                       vk::PipelineStageFlagBits::eComputeShader);
+        stagingRing.submit(slice);
+    }
+    stagingRing.flush();
+    numLoadedVertices.store(numVertexSlots, std::memory_order_release);
+
+    const auto numPages = getNumPages();
+    std::vector<uint32_t> pageSlots(numPages, NOT_RESIDENT);
+    std::vector<uint32_t> slotPages(numPageSlots, NOT_RESIDENT);
+    std::vector<uint32_t> lastRequested(numPages, 0);
+    auto* requests = static_cast<uint32_t *>(pageRequestBuffer->allocation_info.pMappedData);
+    size_t numUploads = 0;
+    bool warnedBudget = false;
+
+    for (uint32_t sweep = 1; !loadingCancelled; sweep++) {
+        // the flags are set by every frame that wants the page, clearing them turns them into a recency
+        vmaInvalidateAllocation(context->allocator, pageRequestBuffer->allocation, 0, VK_WHOLE_SIZE);
+        std::vector<uint32_t> missing;
+        for (uint32_t page = 0; page < numPages; page++) {
+            if (requests[page] != 0) {
+                requests[page] = 0;
+                lastRequested[page] = sweep;
+                if (pageSlots[page] == NOT_RESIDENT) {
+                    missing.push_back(page);
+                }
+            }
+        }
+        vmaFlushAllocation(context->allocator, pageRequestBuffer->allocation, 0, VK_WHOLE_SIZE);
+        if (missing.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            continue;
+        }
+
+        glm::vec3 camera;
+        {
+            std::lock_guard<std::mutex> lock(cameraMutex);
+            camera = cameraPosition;
+        }
+        auto distance = [&](uint32_t page) {
+            return glm::distance(camera, glm::clamp(camera, pageBounds[page].min, pageBounds[page].max));
+        };
+        std::sort(missing.begin(), missing.end(), [&](uint32_t a, uint32_t b) {
+            return distance(a) < distance(b);
+        });
+
+        for (auto page: missing) {
+            if (loadingCancelled) {
+                break;
+            }
+            // a free slot, otherwise the least recently requested page and the furthest one among those
+            auto slot = static_cast<uint32_t>(std::find(slotPages.begin(), slotPages.end(), NOT_RESIDENT) -
+                                              slotPages.begin());
+            if (slot == numPageSlots) {
+                for (uint32_t candidate = 0; candidate < numPageSlots; candidate++) {
+                    auto candidatePage = slotPages[candidate];
+                    if (lastRequested[candidatePage] == sweep) {
+                        continue;
+                    }
+                    if (slot == numPageSlots || lastRequested[candidatePage] < lastRequested[slotPages[slot]] ||
+                        (lastRequested[candidatePage] == lastRequested[slotPages[slot]] &&
+                         distance(candidatePage) > distance(slotPages[slot]))) {
+                        slot = candidate;
+                    }
+                }
+            }
+            if (slot == numPageSlots) {
+                if (!warnedBudget) {
+                    spdlog::warn("The pages in view do not fit into the residency budget");
+                    warnedBudget = true;
+                }
+                break;
+            }
+
+            auto evictedPage = slotPages[slot];
+            uploadPage(context, stagingRing, page, slot, evictedPage);
+            if (evictedPage != NOT_RESIDENT) {
+                pageSlots[evictedPage] = NOT_RESIDENT;
+            }
+            slotPages[slot] = page;
+            pageSlots[page] = slot;
+            numUploads++;
+        }
+    }
+    stagingRing.flush();
+    spdlog::info("Paged in {} pages of {}", numUploads, filename);
+}
+
+void GSScene::uploadPage(const std::shared_ptr<VulkanContext>& context, StagingRing& stagingRing, uint32_t page,
+                         uint32_t slot, uint32_t evictedPage) {
+    auto vertices = cache->get(SceneCache::Section::VERTICES);
+    auto cov3Ds = cache->get(SceneCache::Section::COV3D);
+    const size_t first = static_cast<size_t>(page) * PAGE_SIZE;
+    const size_t count = std::min<size_t>(PAGE_SIZE, numStoredVertices - first);
+    const size_t slotFirst = static_cast<size_t>(slot) * PAGE_SIZE;
+    const auto queueFamily = context->queues[VulkanContext::Queue::COMPUTE].queueFamily;
+
+    auto& slice = stagingRing.acquire();
+    auto commandBuffer = slice.commandBuffer.get();
+    // Frames recorded from now on no longer see the evicted page, the ones submitted before have to finish
+    // reading the slot before it is overwritten. All of them run on the same queue as the ring.
+    if (evictedPage != NOT_RESIDENT) {
+        commandBuffer.updateBuffer(pageTableBuffer->buffer, evictedPage * sizeof(uint32_t), sizeof(uint32_t),
+                                   &NOT_RESIDENT);
+    }
+    Utils::BarrierBuilder slotBarrier;
+    slotBarrier.queueFamilyIndex(queueFamily);
+    for (auto& stream: storageStreams) {
+        slotBarrier.addBufferBarrier(stream.buffer, vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferWrite);
+    }
+    slotBarrier.addBufferBarrier(cov3DBuffer, vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferWrite)
+            .build(commandBuffer, vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer);
+
+    // reading the page from the mapped cache is the actual disk I/O
+    size_t streamOffset = 0;
+    for (auto& stream: storageStreams) {
+        memcpy(slice.data + streamOffset * count, vertices.data() + streamOffset * numStoredVertices +
+                                                  first * stream.range.size, count * stream.range.size);
+        streamOffset += stream.range.size;
+    }
+    const auto cov3DOffset = count * getStoredVertexSize();
+    memcpy(slice.data + cov3DOffset, cov3Ds.data() + first * getCov3DSize(), count * getCov3DSize());
+
+    uploadVertices(stagingRing, slice, 0, slotFirst, count);
+    stagingRing.copy(slice, cov3DOffset, cov3DBuffer, slotFirst * getCov3DSize(), count * getCov3DSize());
+    // the tail of the last page must not show what the slot held before
+    if (count < PAGE_SIZE) {
+        for (auto& stream: storageStreams) {
+            commandBuffer.fillBuffer(stream.buffer->buffer, (slotFirst + count) * stream.range.size,
+                                     (PAGE_SIZE - count) * stream.range.size, 0);
+        }
+    }
+    commandBuffer.updateBuffer(pageTableBuffer->buffer, page * sizeof(uint32_t), sizeof(uint32_t), &slot);
+
+    vertexUploadBarrier(context)
+            .addBufferBarrier(cov3DBuffer, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead)
+            .addBufferBarrier(pageTableBuffer, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead)
+            .build(commandBuffer, vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader);
+    stagingRing.submit(slice);
+}
+
+size_t GSScene::getStoredVertexSize() const {
+    size_t size = 0;
+    for (auto& stream: storageStreams) {
+        size += stream.range.size;
+    }
+    return size;
+}
+
+std::vector<GSScene::VertexStreamRange> GSScene::getStorageStreamRanges() const {
+    std::vector<VertexStreamRange> ranges;
+    for (auto& stream: storageStreams) {
+        ranges.push_back(stream.range);
+    }
+    return ranges;
+}
+
+void GSScene::createVertexBuffers(const std::shared_ptr<VulkanContext>& context) {
+    storageStreams.clear();
+    if (!options.structureOfArrays) {
+        auto buffer = createBuffer(context, numVertexSlots * getVertexSize());
+        storageStreams.push_back({{0, getVertexSize()}, buffer});
+        vertexStreamBuffers.fill(buffer);
+        return;
+    }
+
+    for (int stream = 0; stream < NUM_VERTEX_STREAMS; stream++) {
+        auto range = vertexStreamRange(options.compactStorage, shDegree, static_cast<VertexStream>(stream));
+        auto buffer = createBuffer(context, numVertexSlots * range.size);
+        storageStreams.push_back({range, buffer});
+        vertexStreamBuffers[stream] = buffer;
+    }
+}
+
+void GSScene::uploadVertices(StagingRing& stagingRing, StagingRing::Slice& slice, vk::DeviceSize srcOffset,
+                             size_t first, size_t count) {
+    for (auto& stream: storageStreams) {
+        stagingRing.copy(slice, srcOffset, stream.buffer, first * stream.range.size, count * stream.range.size);
+        srcOffset += count * stream.range.size;
+    }
+}
+
+Utils::BarrierBuilder GSScene::vertexUploadBarrier(const std::shared_ptr<VulkanContext>& context) const {
+    Utils::BarrierBuilder barrier;
+    barrier.queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily);
+    for (auto& stream: storageStreams) {
+        barrier.addBufferBarrier(stream.buffer, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead);
+    }
+    barrier.addBufferBarrier(chunkBoundsBuffer, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead);
+    return barrier;
+}
+
+void GSScene::bindVertexStreams(const std::shared_ptr<DescriptorSet>& descriptorSet) const {
+    // binding 1 holds the covariances
+    static constexpr uint32_t bindings[NUM_VERTEX_STREAMS] = {0, 2, 3, 4};
+    for (int stream = 0; stream < NUM_VERTEX_STREAMS; stream++) {
+        descriptorSet->bindBufferToDescriptorSet(bindings[stream], vk::DescriptorType::eStorageBuffer,
+                                                 vk::ShaderStageFlagBits::eCompute, vertexStreamBuffers[stream]);
+    }
 }
 
 std::shared_ptr<Buffer> GSScene::createBuffer(const std::shared_ptr<VulkanContext>&context, size_t i) {
     return std::make_shared<Buffer>(
-        context, i, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        context, i, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst |
+                    vk::BufferUsageFlagBits::eTransferSrc,
         VMA_MEMORY_USAGE_GPU_ONLY, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, false);
 }
 
-void GSScene::precomputeCov3D(const std::shared_ptr<VulkanContext>&context) {
-    cov3DBuffer = createBuffer(context, header.numVertices * sizeof(float) * 6);
-
-    auto pipeline = std::make_shared<ComputePipeline>(
+void GSScene::createPrecomputeCov3DPipeline(const std::shared_ptr<VulkanContext>&context) {
+    precomputeCov3DPipeline = std::make_shared<ComputePipeline>(
         context, std::make_shared<Shader>(context, "precomp_cov3d", SPV_PRECOMP_COV3D, SPV_PRECOMP_COV3D_len));
 
     auto descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
-    descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
-                                             vertexBuffer);
+    bindVertexStreams(descriptorSet);
     descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              cov3DBuffer);
     descriptorSet->build();
 
-    pipeline->addDescriptorSet(0, descriptorSet);
-    pipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(float));
-    pipeline->build();
+    precomputeCov3DPipeline->addDescriptorSet(0, descriptorSet);
+    precomputeCov3DPipeline->addSpecializationConstant(0, options.compactStorage);
+    precomputeCov3DPipeline->addSpecializationConstant(1, shDegree);
+    precomputeCov3DPipeline->addSpecializationConstant(2, options.structureOfArrays);
+    precomputeCov3DPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0,
+                                             sizeof(PrecomputeCov3DPushConstants));
+    precomputeCov3DPipeline->build();
+}
 
-    auto commandBuffer = context->beginOneTimeCommandBuffer();
-    pipeline->bind(commandBuffer, 0, 0);
-    float scaleFactor = 1.0f;
-    commandBuffer->pushConstants(pipeline->pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0,
-                                 sizeof(float), &scaleFactor);
-    int numGroups = (header.numVertices + 255) / 256;
-    commandBuffer->dispatch(numGroups, 1, 1);
-    context->endOneTimeCommandBuffer(std::move(commandBuffer), VulkanContext::Queue::COMPUTE);
+void GSScene::recordPrecomputeCov3D(const std::shared_ptr<VulkanContext>&context,
+                                    const vk::UniqueCommandBuffer& commandBuffer, uint32_t firstVertex,
+                                    uint32_t numVertices) {
+    auto queueFamily = context->queues[VulkanContext::Queue::COMPUTE].queueFamily;
+    precomputeCov3DPipeline->bind(commandBuffer, 0, 0);
+    PrecomputeCov3DPushConstants pushConstants{1.0f, firstVertex, numVertices};
+    commandBuffer->pushConstants(precomputeCov3DPipeline->pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0,
+                                 sizeof(PrecomputeCov3DPushConstants), &pushConstants);
+    commandBuffer->dispatch((numVertices + 255) / 256, 1, 1);
 
-    spdlog::info("Precomputed Cov3D");
+    // the covariances are read by the renderer and by the cache readback in later submissions
+    Utils::BarrierBuilder().queueFamilyIndex(queueFamily)
+            .addBufferBarrier(cov3DBuffer, vk::AccessFlagBits::eShaderWrite,
+                              vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead)
+            .build(commandBuffer.get(), vk::PipelineStageFlagBits::eComputeShader,
+                   vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer);
 }
@@ -1,41 +1,168 @@
 #ifndef GSSCENE_H
 #define GSSCENE_H
 
+#include <array>
+#include <atomic>
 #include <filesystem>
 #include <iostream>
+#include <mutex>
 #include <glm/glm.hpp>
 #include "vulkan/VulkanContext.h"
 #include "vulkan/Buffer.h"
+#include "SceneCache.h"
+#include "MappedFile.h"
+#include "vulkan/StagingRing.h"
+#include "vulkan/Utils.h"
+
+enum class PlyScalarType {
+    INT8,
+    UINT8,
+    INT16,
+    UINT16,
+    INT32,
+    UINT32,
+    FLOAT16,
+    FLOAT32,
+    FLOAT64
+};
 
 struct PlyProperty {
     std::string type;
     std::string name;
+    PlyScalarType scalarType;
+    uint32_t offset; // byte offset within the element record
 };
 
 struct PlyHeader {
     std::string format;
     int numVertices;
     int numFaces;
+    uint32_t vertexStride; // size of one vertex record in bytes
     std::vector<PlyProperty> vertexProperties;
     std::vector<PlyProperty> faceProperties;
 };
 
+// Property-to-offset mapping compiled from the PLY header. Each gather reads one property of a vertex record
+// and writes it, after an optional affine remap, into a float of GSScene::Vertex.
+struct PlyVertexLayout {
+    struct Gather {
+        uint32_t srcOffset;
+        PlyScalarType type;
+        uint32_t dst; // float index into GSScene::Vertex
+        float scale = 1.0f;
+        float bias = 0.0f;
+    };
+
+    uint32_t stride = 0;
+    uint32_t shDegree = 0;
+    std::vector<Gather> gathers;
+
+    static PlyVertexLayout compile(const PlyHeader& header);
+};
+
+class ComputePipeline;
+class DescriptorSet;
+class ThreadPool;
+
 class GSScene {
 public:
-    explicit GSScene(const std::string& filename)
-        : filename(filename) {
+    struct Options {
+        // read and write the preprocessed .gscache file next to the scene
+        bool useCache = true;
+
+        // store splats as CompactVertex and the covariances packed to fp16, about 2.6x smaller than fp32
+        bool compactStorage = false;
+
+        // SH bands above this degree are dropped when loading, 0 keeps only the view independent color
+        uint32_t maxShDegree = 3;
+
+        // one buffer per vertex stream instead of interleaved vertex records, the preprocess pass then only touches
+        // the SH coefficients of visible splats
+        bool structureOfArrays = false;
+
+        // Splats with a lower opacity or whose largest scale is smaller are removed when loading a PLY file. The
+        // renderer discards alpha below 1/255 anyway, so the default opacity threshold does not change the image.
+        float minOpacity = 1.0f / 255.0f;
+        float minScale = 0.0f;
+
+        // load the splats sorted along a Morton curve, so that neighbouring threads of the shaders read nearby splats
+        bool spatialOrder = false;
+
+        // if set, the pruned scene is also written to this PLY file
+        std::string prunedPlyPath;
+
+        // Append a hierarchy of merged proxy splats for level of detail selection, implies spatialOrder
+        bool buildLod = false;
+
+        // If the splats take more GPU memory than this, only a pool of pages of this size is allocated and pages
+        // are streamed in from the scene cache as the renderer requests them. 0 keeps the whole scene resident.
+        // Implies spatialOrder.
+        uint64_t residencyBudget = 0;
+
+        // stream() runs on a loader thread, so prepare() leaves it the selection of the splats, which reads the
+        // whole PLY body, and the conversion of a paged scene into its cache. The buffers are then sized for all
+        // splats of the file.
+        bool streamInBackground = false;
+
+        // identifies everything that changes the data stored in the cache
+        [[nodiscard]] uint64_t hash() const;
+    };
+
+    GSScene(const std::string& filename, Options options)
+        : filename(filename), options(options) {
         // check if file exists
         if (!std::filesystem::exists(filename)) {
             throw std::runtime_error("File does not exist: " + filename);
         }
+        // proxies merge runs of consecutive splats, which only makes sense if those are close to each other
+        this->options.spatialOrder |= options.buildLod;
+        // a page only covers a small region of the scene and gets culled and evicted as a whole if its splats are close
+        this->options.spatialOrder |= options.residencyBudget > 0;
     }
 
+    // prepare() followed by stream()
     void load(const std::shared_ptr<VulkanContext>& context);
 
+    // Reads the header and allocates the GPU buffers. The splats themselves are uploaded by stream(), which also
+    // selects them with Options::streamInBackground.
+    void prepare(const std::shared_ptr<VulkanContext>& context);
+
+    // Uploads the splats chunk by chunk and advances the loaded vertex count. May run on a loader thread. Paged
+    // scenes keep streaming pages in until cancelLoading() is called, so they always need one.
+    void stream(const std::shared_ptr<VulkanContext>& context);
+
+    // Makes a running stream() return after its current chunk
+    void cancelLoading() {
+        loadingCancelled = true;
+    }
+
+    // Vertices [0, getNumLoadedVertices()) are resident in the vertex stream buffers, cov3DBuffer and
+    // chunkBoundsBuffer. Paged scenes count the whole page pool once the chunk bounds are resident.
+    uint32_t getNumLoadedVertices() const {
+        return numLoadedVertices.load(std::memory_order_acquire);
+    }
+
+    // Splats converted from the PLY file so far, paged scenes only convert them into the cache before loading
+    uint32_t getNumConvertedVertices() const {
+        return numConvertedVertices.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool isPaged() const {
+        return numPageSlots > 0;
+    }
+
+    // the loader of a paged scene brings in the pages closest to this position first
+    void setCameraPosition(const glm::vec3& position) {
+        std::lock_guard<std::mutex> lock(cameraMutex);
+        cameraPosition = position;
+    }
+
     void loadTestScene(const std::shared_ptr<VulkanContext>& context);
 
+    // number of vertex slots including the LOD proxies and the padding between their levels, or the size of the
+    // page pool for paged scenes
     uint64_t getNumVertices() const {
-        return header.numVertices;
+        return numVertexSlots;
     }
 
     struct Vertex {
@@ -49,11 +176,240 @@ public:
         float mat[6];
     };
 
-    std::shared_ptr<Buffer> vertexBuffer;
+    // Compact storage, decoded by splat_storage.glsl. Scale, opacity, rotation and the DC color are fp16, the
+    // higher SH bands are signed 8 bit relative to a per-splat fp16 scale.
+    struct CompactVertex {
+        float position[3];
+        uint32_t scaleOpacity[2];
+        uint32_t rotation[2];
+        uint32_t shDC[2]; // rg, b and the scale of shRest
+        int8_t shRest[48]; // 45 used
+    };
+    static_assert(sizeof(CompactVertex) == 21 * sizeof(uint32_t));
+
+    // upper right of the covariance as fp16 relative to its largest variance, followed by that variance as fp32
+    struct CompactCov3D {
+        uint32_t mat[3];
+        float scale;
+    };
+
+    // Splats are culled in chunks of CHUNK_SIZE consecutive vertices, each is one workgroup of the preprocess pass
+    static constexpr uint32_t CHUNK_SIZE = 256;
+
+    // Proxies of LOD level n + 1 each merge LOD_BRANCHING consecutive splats of level n, so a chunk of proxies
+    // stands in for LOD_BRANCHING chunks of the level below
+    static constexpr uint32_t LOD_BRANCHING = 8;
+    static constexpr uint32_t NO_PARENT_CHUNK = ~0u;
+
+    // World space bounds of the 3 sigma extents of the splats of a chunk, which also contain the bounds of its
+    // children. error is the world space size of the detail lost by drawing this chunk instead of its children.
+    struct ChunkBounds {
+        glm::vec3 min;
+        float error;
+        glm::vec3 max;
+        uint32_t parent;
+    };
+    static_assert(sizeof(ChunkBounds) == 32);
+
+    [[nodiscard]] uint32_t getNumChunks() const {
+        return (numStoredVertices + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    }
+
+    // chunks chunkBoundsBuffer holds, fixed by prepare() unlike getNumChunks(), which a background selection may
+    // lower until the first vertices are loaded
+    [[nodiscard]] uint32_t getNumChunkSlots() const {
+        return numChunkSlots;
+    }
+
+    [[nodiscard]] bool hasLod() const {
+        return lodLevels.size() > 1;
+    }
+
+    // Paged scenes are made resident in pages of PAGE_CHUNKS consecutive chunks, a page is spatially compact since
+    // the splats are stored in Morton order
+    static constexpr uint32_t PAGE_CHUNKS = 16;
+    static constexpr uint32_t PAGE_SIZE = PAGE_CHUNKS * CHUNK_SIZE;
+    static constexpr uint32_t NOT_RESIDENT = ~0u;
+
+    [[nodiscard]] uint32_t getNumPages() const {
+        return (getNumChunks() + PAGE_CHUNKS - 1) / PAGE_CHUNKS;
+    }
+
+    // Only the first (shDegree + 1)^2 SH coefficients are stored, the fp32 and compact layouts are truncated after them
+    static size_t vertexSize(bool compact, uint32_t shDegree);
+
+    static CompactVertex compactVertex(const Vertex& vertex, uint32_t shDegree);
+
+    // Attributes of a splat as read by splat_storage.glsl, each one is a byte range of the vertex record
+    enum VertexStream {
+        POSITION,
+        SCALE_OPACITY,
+        ROTATION,
+        SH,
+        NUM_VERTEX_STREAMS
+    };
+
+    struct VertexStreamRange {
+        size_t offset;
+        size_t size;
+    };
+
+    static VertexStreamRange vertexStreamRange(bool compact, uint32_t shDegree, VertexStream stream);
+
+    [[nodiscard]] size_t getVertexSize() const {
+        return vertexSize(options.compactStorage, shDegree);
+    }
+
+    // bytes per vertex over all vertex buffers, smaller than getVertexSize() if the streams leave parts out
+    [[nodiscard]] size_t getStoredVertexSize() const;
+
+    // degree of the stored SH coefficients, the smaller of the scene's and Options::maxShDegree
+    [[nodiscard]] uint32_t getShDegree() const {
+        return shDegree;
+    }
+
+    [[nodiscard]] size_t getCov3DSize() const {
+        return options.compactStorage ? sizeof(CompactCov3D) : sizeof(Cov3DUpperRight);
+    }
+
+    [[nodiscard]] bool isCompact() const {
+        return options.compactStorage;
+    }
+
+    [[nodiscard]] bool isStructureOfArrays() const {
+        return options.structureOfArrays;
+    }
+
+    // Binds the vertex streams to bindings 0, 2, 3 and 4 as declared by splat_storage.glsl
+    void bindVertexStreams(const std::shared_ptr<DescriptorSet>& descriptorSet) const;
+
+    // buffer of each vertex stream, all of them are the same buffer holding whole records without structureOfArrays
+    std::array<std::shared_ptr<Buffer>, NUM_VERTEX_STREAMS> vertexStreamBuffers;
     std::shared_ptr<Buffer> cov3DBuffer;
+    std::shared_ptr<Buffer> chunkBoundsBuffer;
+    // pool slot of each page or NOT_RESIDENT, and a flag per page set by the renderer when it wants the page. Both
+    // have a single entry for scenes that are not paged.
+    std::shared_ptr<Buffer> pageTableBuffer;
+    std::shared_ptr<Buffer> pageRequestBuffer;
 private:
     std::string filename;
+    Options options;
     PlyHeader header;
+    uint32_t shDegree = 3;
+
+    // Level 0 holds the header.numVertices splats of the scene, each further level the proxies merging the one
+    // below. Levels start on a chunk boundary, the slots in between are left zero and thereby transparent.
+    struct LodLevel {
+        uint32_t firstVertex;
+        uint32_t numVertices;
+        uint32_t numChunks;
+    };
+    std::vector<LodLevel> lodLevels;
+    uint32_t numStoredVertices = 0;
+
+    // the GPU buffers hold numVertexSlots vertices, numPageSlots pages of them for paged scenes
+    uint32_t numVertexSlots = 0;
+    uint32_t numChunkSlots = 0;
+    uint32_t numPageSlots = 0;
+    std::vector<ChunkBounds> pageBounds;
+    std::mutex cameraMutex;
+    glm::vec3 cameraPosition{0.0f};
+
+    struct CacheMetadata {
+        uint32_t shDegree;
+        uint32_t numSceneVertices;
+        uint32_t reserved[2];
+    };
+
+    // source of the splats between prepare() and stream(), either the cache or the PLY body
+    std::unique_ptr<SceneCache> cache;
+    std::unique_ptr<MappedFile> plyMapping;
+    size_t plyBodyOffset = 0;
+    PlyVertexLayout plyLayout;
+    // PLY record of each vertex after pruning and reordering, empty if every record is loaded in file order
+    std::vector<uint32_t> plySourceIndices;
+    size_t numPrunedVertices = 0;
+    // stream() selects the splats before converting them, see Options::streamInBackground
+    bool selectionPending = false;
+
+    // The stored copies of the vertices, a single stream of whole records or one per VertexStream. A chunk of
+    // vertices is laid out like the buffers: the first stream of all of them, then the next stream and so on.
+    struct StorageStream {
+        VertexStreamRange range;
+        std::shared_ptr<Buffer> buffer;
+    };
+    std::vector<StorageStream> storageStreams;
+
+    std::shared_ptr<ComputePipeline> precomputeCov3DPipeline;
+    std::atomic<uint32_t> numLoadedVertices = 0;
+    std::atomic<uint32_t> numConvertedVertices = 0;
+    std::atomic<bool> loadingCancelled = false;
+
+    struct PrecomputeCov3DPushConstants {
+        float scaleFactor;
+        uint32_t firstVertex;
+        uint32_t numVertices;
+    };
+
+    [[nodiscard]] std::vector<VertexStreamRange> getStorageStreamRanges() const;
+
+    // Lays out the LOD levels over header.numVertices scene splats and sets numStoredVertices
+    void computeLodLevels();
+
+    // global index of the parent of chunk `chunk` of LOD level `level`, or NO_PARENT_CHUNK for the top level
+    [[nodiscard]] uint32_t parentChunk(size_t level, size_t chunk) const;
+
+    // Sizes the vertex slots and the page pool for Options::residencyBudget, leaves the scene unpaged if it fits
+    void planPaging();
+
+    void createPageBuffers(const std::shared_ptr<VulkanContext>& context);
+
+    // Converts the PLY file of a paged scene into the cache and opens it
+    void convertToCache(const std::shared_ptr<VulkanContext>& context);
+
+    // Uploads the chunk bounds, then moves the pages requested by the renderer into the pool until cancelled
+    void streamPages(const std::shared_ptr<VulkanContext>& context);
+
+    // Copies a page from the cache into a pool slot, replacing evictedPage if that is not NOT_RESIDENT
+    void uploadPage(const std::shared_ptr<VulkanContext>& context, StagingRing& stagingRing, uint32_t page,
+                    uint32_t slot, uint32_t evictedPage);
+
+    void createVertexBuffers(const std::shared_ptr<VulkanContext>& context);
+
+    // Copies the chunk [first, first + count) laid out as described for storageStreams into the buffers
+    void uploadVertices(StagingRing& stagingRing, StagingRing::Slice& slice, vk::DeviceSize srcOffset, size_t first,
+                        size_t count);
+
+    // barrier from the vertex uploads to the shaders reading them
+    [[nodiscard]] Utils::BarrierBuilder vertexUploadBarrier(const std::shared_ptr<VulkanContext>& context) const;
+
+    // Selects the records above the pruning thresholds into plySourceIndices and sorts them if requested
+    void selectVertices();
+
+    void writePrunedPly() const;
+
+    // Converts the PLY file and uploads it. Paged scenes are only converted into the cache, including their
+    // covariances, the GPU sees them page by page afterwards.
+    void streamFromPly(const std::shared_ptr<VulkanContext>& context);
+
+    // Uploads the proxy levels above the scene splats, starting from the level 1 proxies collected while the scene
+    // was converted and the bounds of its chunks
+    void streamLodLevels(const std::shared_ptr<VulkanContext>& context, ThreadPool& threadPool,
+                         StagingRing& stagingRing, std::unique_ptr<SceneCache::Writer>& cacheWriter,
+                         std::vector<Vertex> vertices, std::vector<ChunkBounds> childBounds);
+
+    void streamFromCache(const std::shared_ptr<VulkanContext>& context);
+
+    // Returns nullptr if the cache cannot be created, the scene is loaded without writing one then
+    std::unique_ptr<SceneCache::Writer> createCacheWriter() const;
+
+    // Writes the vertices [first, first + count) of a slice, the bounds of their chunks and, if not null, their
+    // covariances. Drops the writer on errors.
+    void writeCacheSlice(std::unique_ptr<SceneCache::Writer>& writer, const char* vertices, const char* bounds,
+                         const char* cov3Ds, size_t first, size_t count) const;
+
+    // Reads the covariances back from the GPU unless they were written with the vertices, and commits the cache
+    void commitCache(const std::shared_ptr<VulkanContext>& context, SceneCache::Writer& writer);
 
     std::shared_ptr<Buffer> createStagingBuffer(const std::shared_ptr<VulkanContext>& sharedPtr, unsigned long i);
 
@@ -61,7 +417,12 @@ private:
 
     static std::shared_ptr<Buffer> createBuffer(const std::shared_ptr<VulkanContext>& sharedPtr, size_t i);
 
-    void precomputeCov3D(const std::shared_ptr<VulkanContext>& context);
+    void createPrecomputeCov3DPipeline(const std::shared_ptr<VulkanContext>& context);
+
+    // Records the covariance computation of [firstVertex, firstVertex + numVertices), their upload has to be
+    // made visible with vertexUploadBarrier() first
+    void recordPrecomputeCov3D(const std::shared_ptr<VulkanContext>& context, const vk::UniqueCommandBuffer& commandBuffer,
+                               uint32_t firstVertex, uint32_t numVertices);
 };
 
 
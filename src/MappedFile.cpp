@@ -0,0 +1,115 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& filename) : filename(filename) {
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        fileHandle = nullptr;
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+        CloseHandle(fileHandle);
+        throw std::runtime_error("Could not query file size: " + filename);
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) {
+        return;
+    }
+
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+        CloseHandle(fileHandle);
+        throw std::runtime_error("Could not map file: " + filename);
+    }
+
+    mapped = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (mapped == nullptr) {
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        throw std::runtime_error("Could not map file: " + filename);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (mapped != nullptr) {
+        UnmapViewOfFile(mapped);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr) {
+        CloseHandle(fileHandle);
+    }
+}
+#else
+MappedFile::MappedFile(const std::string& filename) : filename(filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+
+    struct stat fileStat {};
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not query file size: " + filename);
+    }
+    length = static_cast<size_t>(fileStat.st_size);
+    if (length == 0) {
+        close(fd);
+        return;
+    }
+
+    void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Could not map file: " + filename);
+    }
+    mapped = static_cast<const char *>(address);
+    madvise(address, length, MADV_SEQUENTIAL);
+}
+
+MappedFile::~MappedFile() {
+    if (mapped != nullptr) {
+        munmap(const_cast<char *>(mapped), length);
+    }
+}
+#endif
+
+void MappedFile::prefetch(size_t offset, size_t size) const {
+    if (offset >= length) {
+        return;
+    }
+    size = std::min(size, length - offset);
+
+#ifndef _WIN32
+    // madvise needs a page aligned start address
+    auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto alignedOffset = offset / pageSize * pageSize;
+    madvise(const_cast<char *>(mapped) + alignedOffset, size + offset - alignedOffset, MADV_WILLNEED);
+#else
+    constexpr size_t pageSize = 4096;
+#endif
+
+    volatile char sink = 0;
+    for (size_t i = offset; i < offset + size; i += pageSize) {
+        sink = sink + mapped[i];
+    }
+}
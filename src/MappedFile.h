@@ -0,0 +1,45 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename);
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile &operator=(MappedFile &&) = delete;
+
+    ~MappedFile();
+
+    [[nodiscard]] const char* data() const {
+        return mapped;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return length;
+    }
+
+    // Touches every page of [offset, offset + size) so that later accesses do not fault
+    void prefetch(size_t offset, size_t size) const;
+
+private:
+    std::string filename;
+    const char* mapped = nullptr;
+    size_t length = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+
+#endif //MAPPEDFILE_H
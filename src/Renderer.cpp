@@ -1,5 +1,7 @@
 #include "Renderer.h"
 
+#include <algorithm>
+#include <bit>
 #include <fstream>
 
 #include "vulkan/Swapchain.h"
@@ -13,6 +15,7 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include "vulkan/Utils.h"
+#include "DeviceTuning.h"
 
 #include <spdlog/spdlog.h>
 
@@ -21,13 +24,17 @@ void Renderer::initialize() {
     createGui();
     loadSceneToGPU();
     createPreprocessPipeline();
+    createChunkCullPipeline();
     createPrefixSumPipeline();
     createRadixSortPipeline();
+    createOnesweepSortPipeline();
     createPreprocessSortPipeline();
     createTileBoundaryPipeline();
+    createTileSortPipeline();
     createRenderPipeline();
     createCommandPool();
-    recordPreprocessCommandBuffer();
+    // the pipelines of later runs are ready before the first frame even if this one does not exit cleanly
+    context->savePipelineCache();
 }
 
 void Renderer::handleInput() {
@@ -84,7 +91,8 @@ void Renderer::handleInput() {
 
 void Renderer::retrieveTimestamps() {
     std::vector<uint64_t> timestamps(queryManager->nextId);
-    auto res = context->device->getQueryPoolResults(context->queryPool.get(), 0, queryManager->nextId,
+    auto res = context->device->getQueryPoolResults(context->queryPool.get(), currentFrame * QUERIES_PER_FRAME,
+                                                    queryManager->nextId,
                                                     timestamps.size() * sizeof(uint64_t),
                                                     timestamps.data(), sizeof(uint64_t),
                                                     vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
@@ -93,26 +101,48 @@ void Renderer::retrieveTimestamps() {
     }
 
     auto metrics = queryManager->parseResults(timestamps);
+    frameTime = 0.0;
     for (auto& metric: metrics) {
+        frameTime += metric.second / 1000000.0;
         if (configuration.enableGui)
             guiManager.pushMetric(metric.first, metric.second / 1000000.0);
     }
 }
 
+DeviceTuning Renderer::getTuning() const {
+    return {tileWidth, tileHeight, numRadixSortBlocksPerWorkgroup, onesweepSort};
+}
+
+std::string Renderer::getDeviceKey() const {
+    return DeviceTuning::deviceKey(context->physicalDevice);
+}
+
+uint32_t Renderer::timestampQuery(const std::string& name) {
+    return queryManager->registerQuery(name) + currentFrame * QUERIES_PER_FRAME;
+}
+
 void Renderer::recreateSwapchain() {
     auto oldExtent = swapchain->swapchainExtent;
     spdlog::debug("Recreating swapchain");
     swapchain->recreate();
-    if (swapchain->swapchainExtent == oldExtent) {
-        return;
+    // the images are new even if the extent is not
+    allocateRenderCommandBuffers();
+    renderVersion++;
+
+    if (swapchain->swapchainExtent != oldExtent) {
+        auto [width, height] = swapchain->swapchainExtent;
+        auto tileX = (width + tileWidth - 1) / tileWidth;
+        auto tileY = (height + tileHeight - 1) / tileHeight;
+        tileBoundaryBuffer->realloc(tileX * tileY * sizeof(uint32_t) * 2);
+        updateSortKeyLayout();
+        if (configuration.enableTileSort) {
+            tileCountBuffer->realloc(tileX * tileY * sizeof(uint32_t));
+            tileOffsetBuffer->realloc(tileX * tileY * sizeof(uint32_t));
+            tileOffsetPartitionBuffer->realloc(
+                (tileX * tileY + PREFIX_SUM_PARTITION_SIZE - 1) / PREFIX_SUM_PARTITION_SIZE * sizeof(uint32_t));
+        }
+        preprocessVersion++;
     }
-
-    auto [width, height] = swapchain->swapchainExtent;
-    auto tileX = (width + 16 - 1) / 16;
-    auto tileY = (height + 16 - 1) / 16;
-    tileBoundaryBuffer->realloc(tileX * tileY * sizeof(uint32_t) * 2);
-
-    recordPreprocessCommandBuffer();
     createRenderPipeline();
 }
 
@@ -139,7 +169,9 @@ void Renderer::initializeVulkan() {
 #endif
 
     context->createLogicalDevice(pdf, pdf11, pdf12);
-    context->createDescriptorPool(1);
+    selectDeviceConstants();
+    context->createDescriptorPool(FRAMES_IN_FLIGHT);
+    context->createPipelineCache(configuration.pipelineCachePath);
 
     swapchain = std::make_shared<Swapchain>(context, window, configuration.immediateSwapchain);
 
@@ -154,35 +186,142 @@ void Renderer::initializeVulkan() {
     }
 }
 
+void Renderer::selectDeviceConstants() {
+    auto properties = context->physicalDevice.getProperties2<vk::PhysicalDeviceProperties2,
+        vk::PhysicalDeviceSubgroupProperties>();
+    auto& limits = properties.get<vk::PhysicalDeviceProperties2>().properties.limits;
+    auto vendorId = properties.get<vk::PhysicalDeviceProperties2>().properties.vendorID;
+
+    // the sort shaders work with subgroups of any width, which is only reported here
+    auto subgroupSize = properties.get<vk::PhysicalDeviceSubgroupProperties>().subgroupSize;
+
+    // the render pass runs one invocation per pixel of a tile and keeps a batch of as many splats in shared memory
+    auto maxWorkgroupSize = configuration.maxWorkgroupSize != 0
+                                ? configuration.maxWorkgroupSize
+                                : std::min(limits.maxComputeWorkGroupInvocations, limits.maxComputeWorkGroupSize[0]);
+    auto maxSharedMemory = configuration.maxSharedMemory != 0
+                               ? configuration.maxSharedMemory
+                               : limits.maxComputeSharedMemorySize;
+    auto maxTilePixels = std::min(maxWorkgroupSize, maxSharedMemory / RENDER_SHARED_BYTES_PER_SPLAT);
+    tileWidth = 16;
+    tileHeight = 16;
+    while (tileWidth * tileHeight > maxTilePixels && tileWidth * tileHeight > 64) {
+        if (tileHeight == tileWidth) {
+            tileHeight /= 2;
+        } else {
+            tileWidth /= 2;
+        }
+    }
+
+    // every radix sort workgroup scans the histograms of all workgroups, fewer and longer ones suit the Apple GPUs
+    numRadixSortBlocksPerWorkgroup = vendorId == 0x106B ? 256 : 32;
+
+    // a calibration run for this device replaces the defaults, the configuration replaces both
+    auto tileWidthOverride = configuration.tileWidth;
+    auto tileHeightOverride = configuration.tileHeight;
+    auto blocksOverride = configuration.radixSortBlocksPerWorkgroup;
+    if (!configuration.tuningPath.empty()) {
+        auto key = DeviceTuning::deviceKey(context->physicalDevice);
+        if (auto tuning = DeviceTuning::load(configuration.tuningPath, key)) {
+            spdlog::info("Using the tuning of device {} from {}", key, configuration.tuningPath);
+            tileWidthOverride = tileWidthOverride != 0 ? tileWidthOverride : tuning->tileWidth;
+            tileHeightOverride = tileHeightOverride != 0 ? tileHeightOverride : tuning->tileHeight;
+            blocksOverride = blocksOverride != 0 ? blocksOverride : tuning->radixSortBlocksPerWorkgroup;
+            tunedOnesweepSort = tuning->onesweepSort;
+        }
+    }
+    if (tileWidthOverride != 0 || tileHeightOverride != 0) {
+        auto width = tileWidthOverride != 0 ? tileWidthOverride : tileWidth;
+        auto height = tileHeightOverride != 0 ? tileHeightOverride : tileHeight;
+        if (width * height > maxTilePixels) {
+            spdlog::warn("{}x{} tiles do not fit into a workgroup of the device", width, height);
+        } else {
+            tileWidth = width;
+            tileHeight = height;
+        }
+    }
+    if (blocksOverride != 0) {
+        numRadixSortBlocksPerWorkgroup = blocksOverride;
+    }
+
+    spdlog::info("Using {}x{} tiles, subgroups of {} and {} radix sort blocks per workgroup", tileWidth, tileHeight,
+                 subgroupSize, numRadixSortBlocksPerWorkgroup);
+}
+
 void Renderer::loadSceneToGPU() {
     spdlog::debug("Loading scene to GPU");
-    scene = std::make_shared<GSScene>(configuration.scene);
-    scene->load(context);
+    if (configuration.enableLod && !configuration.enableChunkCulling) {
+        spdlog::warn("Enabling chunk culling, it selects the level of detail");
+        configuration.enableChunkCulling = true;
+    }
+    if (configuration.vramBudgetMB > 0 && !configuration.enableChunkCulling) {
+        spdlog::warn("Enabling chunk culling, it requests the pages of paged scenes");
+        configuration.enableChunkCulling = true;
+    }
+    scene = std::make_shared<GSScene>(configuration.scene, GSScene::Options{
+                                          .useCache = configuration.enableSceneCache,
+                                          .compactStorage = configuration.compactSplatStorage,
+                                          .maxShDegree = configuration.maxShDegree,
+                                          .structureOfArrays = configuration.soaSplatLayout,
+                                          .minOpacity = configuration.pruneMinOpacity,
+                                          .minScale = configuration.pruneMinScale,
+                                          .spatialOrder = configuration.spatialSplatOrder ||
+                                                          configuration.enableChunkCulling,
+                                          .prunedPlyPath = configuration.prunedScenePath,
+                                          .buildLod = configuration.enableLod,
+                                          .residencyBudget = static_cast<uint64_t>(configuration.vramBudgetMB) << 20,
+                                          .streamInBackground = configuration.asyncSceneLoading ||
+                                                                configuration.vramBudgetMB > 0
+                                      });
+    // only the header is read here, the splats are drawn as their chunks arrive
+    scene->prepare(context);
+    // paged scenes keep loading what the renderer asks for
+    if (!configuration.asyncSceneLoading && !scene->isPaged()) {
+        scene->stream(context);
+        numResidentVertices = scene->getNumLoadedVertices();
+        return;
+    }
+
+    sceneLoader = std::thread([this] {
+        try {
+            scene->stream(context);
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to load scene: {}", e.what());
+        }
+    });
+}
 
-    // reset descriptor pool
-    context->device->resetDescriptorPool(context->descriptorPool.get());
+void Renderer::stopSceneLoader() {
+    if (sceneLoader.joinable()) {
+        scene->cancelLoading();
+        sceneLoader.join();
+    }
 }
 
 void Renderer::createPreprocessPipeline() {
     spdlog::debug("Creating preprocess pipeline");
-    uniformBuffer = Buffer::uniform(context, sizeof(UniformBuffer));
+    for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        uniformBuffers.push_back(Buffer::uniform(context, sizeof(UniformBuffer)));
+    }
     vertexAttributeBuffer = Buffer::storage(context, scene->getNumVertices() * sizeof(VertexAttributeBuffer), false);
     tileOverlapBuffer = Buffer::storage(context, scene->getNumVertices() * sizeof(uint32_t), false);
+    visibleChunksBuffer = Buffer::storage(context, scene->getNumChunkSlots() * sizeof(uint32_t), false);
 
     preprocessPipeline = std::make_shared<ComputePipeline>(
         context, std::make_shared<Shader>(context, "preprocess", SPV_PREPROCESS, SPV_PREPROCESS_len));
     inputSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
-    inputSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
-                                        scene->vertexBuffer);
     inputSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                         scene->cov3DBuffer);
+    scene->bindVertexStreams(inputSet);
+    inputSet->bindBufferToDescriptorSet(5, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                        visibleChunksBuffer);
     inputSet->build();
     preprocessPipeline->addDescriptorSet(0, inputSet);
 
     auto uniformOutputSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
     uniformOutputSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eUniformBuffer,
                                                 vk::ShaderStageFlagBits::eCompute,
-                                                uniformBuffer);
+                                                uniformBuffers);
     uniformOutputSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer,
                                                 vk::ShaderStageFlagBits::eCompute,
                                                 vertexAttributeBuffer);
@@ -192,7 +331,54 @@ void Renderer::createPreprocessPipeline() {
     uniformOutputSet->build();
 
     preprocessPipeline->addDescriptorSet(1, uniformOutputSet);
+    preprocessPipeline->addSpecializationConstant(0, scene->isCompact());
+    preprocessPipeline->addSpecializationConstant(1, scene->getShDegree());
+    preprocessPipeline->addSpecializationConstant(2, scene->isStructureOfArrays());
+    preprocessPipeline->addSpecializationConstant(3, configuration.enableChunkCulling);
+    preprocessPipeline->addSpecializationConstant(10, tileWidth);
+    preprocessPipeline->addSpecializationConstant(11, tileHeight);
+    preprocessPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t));
     preprocessPipeline->build();
+
+    // splats that are not resident yet never get preprocessed and have to count as invisible
+    auto commandBuffer = context->beginOneTimeCommandBuffer();
+    commandBuffer->fillBuffer(vertexAttributeBuffer->buffer, 0, VK_WHOLE_SIZE, 0);
+    commandBuffer->fillBuffer(tileOverlapBuffer->buffer, 0, VK_WHOLE_SIZE, 0);
+    context->endOneTimeCommandBuffer(std::move(commandBuffer), VulkanContext::Queue::COMPUTE);
+}
+
+void Renderer::createChunkCullPipeline() {
+    if (!configuration.enableChunkCulling) {
+        return;
+    }
+
+    spdlog::debug("Creating chunk cull pipeline");
+    preprocessDispatchBuffer = Buffer::indirect(context, sizeof(vk::DispatchIndirectCommand));
+
+    chunkCullPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "chunk_cull", SPV_CHUNK_CULL, SPV_CHUNK_CULL_len));
+    auto descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+    descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             scene->chunkBoundsBuffer);
+    descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             visibleChunksBuffer);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             preprocessDispatchBuffer);
+    descriptorSet->bindBufferToDescriptorSet(3, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             scene->pageTableBuffer);
+    descriptorSet->bindBufferToDescriptorSet(4, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             scene->pageRequestBuffer);
+    descriptorSet->build();
+    chunkCullPipeline->addDescriptorSet(0, descriptorSet);
+
+    auto uniformSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+    uniformSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eCompute,
+                                          uniformBuffers);
+    uniformSet->build();
+    chunkCullPipeline->addDescriptorSet(1, uniformSet);
+    chunkCullPipeline->addSpecializationConstant(0, scene->isPaged());
+    chunkCullPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(ChunkCullPushConstants));
+    chunkCullPipeline->build();
 }
 
 Renderer::Renderer(VulkanSplatting::RendererConfiguration configuration) : configuration(std::move(configuration)) {
@@ -212,21 +398,28 @@ void Renderer::createGui() {
 
 void Renderer::createPrefixSumPipeline() {
     spdlog::debug("Creating prefix sum pipeline");
-    prefixSumPingBuffer = Buffer::storage(context, scene->getNumVertices() * sizeof(uint32_t), false);
-    prefixSumPongBuffer = Buffer::storage(context, scene->getNumVertices() * sizeof(uint32_t), false);
-    totalSumBufferHost = Buffer::staging(context, sizeof(uint32_t));
+    prefixSumBuffer = Buffer::storage(context, scene->getNumVertices() * sizeof(uint32_t), false);
+    auto numPartitions = (scene->getNumVertices() + PREFIX_SUM_PARTITION_SIZE - 1) / PREFIX_SUM_PARTITION_SIZE;
+    prefixSumPartitionBuffer = Buffer::storage(context, std::max<uint64_t>(numPartitions, 1) * sizeof(uint32_t),
+                                               false);
+    for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        totalSumBuffersHost.push_back(Buffer::staging(context, sizeof(uint32_t)));
+        *static_cast<uint32_t *>(totalSumBuffersHost[i]->allocation_info.pMappedData) = 0;
+    }
 
     prefixSumPipeline = std::make_shared<ComputePipeline>(
         context, std::make_shared<Shader>(context, "prefix_sum", SPV_PREFIX_SUM, SPV_PREFIX_SUM_len));
     auto descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
     descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
-                                             prefixSumPingBuffer);
+                                             tileOverlapBuffer);
     descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
-                                             prefixSumPongBuffer);
+                                             prefixSumBuffer);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             prefixSumPartitionBuffer);
     descriptorSet->build();
 
     prefixSumPipeline->addDescriptorSet(0, descriptorSet);
-    prefixSumPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t));
+    prefixSumPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(PrefixSumPushConstants));
     prefixSumPipeline->build();
 }
 
@@ -249,10 +442,29 @@ void Renderer::createRadixSortPipeline() {
 
     sortHistBuffer = Buffer::storage(context, numWorkgroups * 256 * sizeof(uint32_t), false);
 
+    sortArgsBuffer = Buffer::indirect(context, sizeof(SortArgs));
+
+    dispatchArgsPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "dispatch_args", SPV_DISPATCH_ARGS, SPV_DISPATCH_ARGS_len));
+    auto argsSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+    argsSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                       prefixSumBuffer);
+    argsSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                       sortArgsBuffer);
+    argsSet->build();
+    dispatchArgsPipeline->addDescriptorSet(0, argsSet);
+    dispatchArgsPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(DispatchArgsPushConstants));
+    dispatchArgsPipeline->build();
+
     sortHistPipeline = std::make_shared<ComputePipeline>(
         context, std::make_shared<Shader>(context, "hist", SPV_HIST, SPV_HIST_len));
     sortPipeline = std::make_shared<ComputePipeline>(
         context, std::make_shared<Shader>(context, "sort", SPV_SORT, SPV_SORT_len));
+    // the same passes for keys of at most 32 bits, they share the buffers
+    shortKeySortHistPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "hist32", SPV_HIST32, SPV_HIST32_len));
+    shortKeySortPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "sort32", SPV_SORT32, SPV_SORT32_len));
 
     auto descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
     descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
@@ -261,10 +473,15 @@ void Renderer::createRadixSortPipeline() {
                                              sortKBufferOdd);
     descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              sortHistBuffer);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortArgsBuffer);
     descriptorSet->build();
-    sortHistPipeline->addDescriptorSet(0, descriptorSet);
-    sortHistPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(RadixSortPushConstants));
-    sortHistPipeline->build();
+    for (auto& pipeline: {sortHistPipeline, shortKeySortHistPipeline}) {
+        pipeline->addDescriptorSet(0, descriptorSet);
+        pipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(RadixSortPushConstants));
+        pipeline->addSpecializationConstant(1, numRadixSortBlocksPerWorkgroup);
+        pipeline->build();
+    }
 
     descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
     descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
@@ -285,10 +502,98 @@ void Renderer::createRadixSortPipeline() {
                                              sortVBufferEven);
     descriptorSet->bindBufferToDescriptorSet(4, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              sortHistBuffer);
+    descriptorSet->bindBufferToDescriptorSet(5, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortArgsBuffer);
+    descriptorSet->build();
+    for (auto& pipeline: {sortPipeline, shortKeySortPipeline}) {
+        pipeline->addDescriptorSet(0, descriptorSet);
+        pipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(RadixSortPushConstants));
+        pipeline->addSpecializationConstant(1, numRadixSortBlocksPerWorkgroup);
+        pipeline->build();
+    }
+}
+
+void Renderer::createOnesweepSortPipeline() {
+    // the per tile sort replaces the global sort
+    if (!configuration.enableOnesweepSort.value_or(tunedOnesweepSort) || configuration.enableTileSort) {
+        return;
+    }
+
+    // The chained scan spins on the partitions of earlier workgroups. Only the desktop vendors keep those running
+    // while others wait, elsewhere the sort could hang, so it keeps the histogram per digit.
+    auto vendorId = context->physicalDevice.getProperties().vendorID;
+    if (vendorId != 0x10DE && vendorId != 0x1002 && vendorId != 0x8086) {
+        spdlog::warn("Onesweep sort is not supported on this device, using the radix sort");
+        return;
+    }
+
+    spdlog::debug("Creating onesweep sort pipeline");
+    onesweepSort = true;
+    onesweepHistBuffer = Buffer::storage(context, 8 * 256 * sizeof(uint32_t), false);
+    onesweepStatusBuffer = Buffer::storage(context, onesweepStatusSize(8), false);
+
+    onesweepHistPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "onesweep_hist", SPV_ONESWEEP_HIST, SPV_ONESWEEP_HIST_len));
+    onesweepPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "onesweep", SPV_ONESWEEP, SPV_ONESWEEP_len));
+    shortKeyOnesweepHistPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "onesweep_hist32", SPV_ONESWEEP_HIST32,
+                                          SPV_ONESWEEP_HIST32_len));
+    shortKeyOnesweepPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "onesweep32", SPV_ONESWEEP32, SPV_ONESWEEP32_len));
+
+    auto descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+    descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortKBufferEven);
+    descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             onesweepHistBuffer);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortArgsBuffer);
+    descriptorSet->bindBufferToDescriptorSet(3, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             onesweepStatusBuffer);
+    descriptorSet->build();
+    for (auto& pipeline: {onesweepHistPipeline, shortKeyOnesweepHistPipeline}) {
+        pipeline->addDescriptorSet(0, descriptorSet);
+        pipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(OnesweepPushConstants));
+        pipeline->build();
+    }
+
+    descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+    descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortKBufferEven);
+    descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortKBufferOdd);
+    descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortKBufferOdd);
+    descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortKBufferEven);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortVBufferEven);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortVBufferOdd);
+    descriptorSet->bindBufferToDescriptorSet(3, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortVBufferOdd);
+    descriptorSet->bindBufferToDescriptorSet(3, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortVBufferEven);
+    descriptorSet->bindBufferToDescriptorSet(4, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             onesweepHistBuffer);
+    descriptorSet->bindBufferToDescriptorSet(5, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortArgsBuffer);
+    descriptorSet->bindBufferToDescriptorSet(6, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             onesweepStatusBuffer);
     descriptorSet->build();
-    sortPipeline->addDescriptorSet(0, descriptorSet);
-    sortPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(RadixSortPushConstants));
-    sortPipeline->build();
+    for (auto& pipeline: {onesweepPipeline, shortKeyOnesweepPipeline}) {
+        pipeline->addDescriptorSet(0, descriptorSet);
+        pipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(OnesweepPushConstants));
+        pipeline->build();
+    }
+}
+
+uint64_t Renderer::onesweepStatusSize(uint32_t numPasses) const {
+    // the partition counters of the at most 8 passes, then the status of every bin of every partition of a pass
+    uint64_t capacity = static_cast<uint64_t>(scene->getNumVertices()) * sortBufferSizeMultiplier;
+    auto numPartitions = std::max<uint64_t>((capacity + ONESWEEP_PARTITION_SIZE - 1) / ONESWEEP_PARTITION_SIZE, 1);
+    return (8 + numPasses * numPartitions * 256) * sizeof(uint32_t);
 }
 
 void Renderer::createPreprocessSortPipeline() {
@@ -299,9 +604,7 @@ void Renderer::createPreprocessSortPipeline() {
     descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              vertexAttributeBuffer);
     descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
-                                             prefixSumPingBuffer);
-    descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
-                                             prefixSumPongBuffer);
+                                             prefixSumBuffer);
     descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              sortKBufferEven);
     descriptorSet->bindBufferToDescriptorSet(3, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
@@ -309,15 +612,18 @@ void Renderer::createPreprocessSortPipeline() {
     descriptorSet->build();
 
     preprocessSortPipeline->addDescriptorSet(0, descriptorSet);
-    preprocessSortPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t));
+    preprocessSortPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0,
+                                            sizeof(PreprocessSortPushConstants));
+    preprocessSortPipeline->addSpecializationConstant(10, tileWidth);
+    preprocessSortPipeline->addSpecializationConstant(11, tileHeight);
     preprocessSortPipeline->build();
 }
 
 void Renderer::createTileBoundaryPipeline() {
     spdlog::debug("Creating tile boundary pipeline");
     auto [width, height] = swapchain->swapchainExtent;
-    auto tileX = (width + 16 - 1) / 16;
-    auto tileY = (height + 16 - 1) / 16;
+    auto tileX = (width + tileWidth - 1) / tileWidth;
+    auto tileY = (height + tileHeight - 1) / tileHeight;
     tileBoundaryBuffer = Buffer::storage(context, tileX * tileY * sizeof(uint32_t) * 2, false);
 
     tileBoundaryPipeline = std::make_shared<ComputePipeline>(
@@ -325,15 +631,101 @@ void Renderer::createTileBoundaryPipeline() {
     auto descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
     descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              sortKBufferEven);
-    // descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
-    //                                          sortKBufferOdd);
+    descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortKBufferOdd);
     descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              tileBoundaryBuffer);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortArgsBuffer);
     descriptorSet->build();
 
     tileBoundaryPipeline->addDescriptorSet(0, descriptorSet);
-    tileBoundaryPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t));
+    tileBoundaryPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(TileBoundaryPushConstants));
     tileBoundaryPipeline->build();
+
+    updateSortKeyLayout();
+}
+
+void Renderer::createTileSortPipeline() {
+    if (!configuration.enableTileSort) {
+        return;
+    }
+
+    spdlog::debug("Creating tile sort pipeline");
+    auto [width, height] = swapchain->swapchainExtent;
+    auto numTiles = ((width + tileWidth - 1) / tileWidth) * ((height + tileHeight - 1) / tileHeight);
+    tileCountBuffer = Buffer::storage(context, numTiles * sizeof(uint32_t), false);
+    tileOffsetBuffer = Buffer::storage(context, numTiles * sizeof(uint32_t), false);
+    tileOffsetPartitionBuffer = Buffer::storage(
+        context, (numTiles + PREFIX_SUM_PARTITION_SIZE - 1) / PREFIX_SUM_PARTITION_SIZE * sizeof(uint32_t), false);
+
+    tileBucketPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "tile_bucket", SPV_TILE_BUCKET, SPV_TILE_BUCKET_len));
+    auto descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+    descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             vertexAttributeBuffer);
+    descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             tileCountBuffer);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             tileOffsetBuffer);
+    descriptorSet->bindBufferToDescriptorSet(3, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortKBufferEven);
+    descriptorSet->bindBufferToDescriptorSet(4, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortVBufferEven);
+    descriptorSet->bindBufferToDescriptorSet(5, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             tileOverlapBuffer);
+    descriptorSet->build();
+    tileBucketPipeline->addDescriptorSet(0, descriptorSet);
+    tileBucketPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(TileBucketPushConstants));
+    tileBucketPipeline->addSpecializationConstant(10, tileWidth);
+    tileBucketPipeline->addSpecializationConstant(11, tileHeight);
+    tileBucketPipeline->build();
+
+    // the tile counts are scanned like the tile overlaps of the splats
+    tileOffsetPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "prefix_sum", SPV_PREFIX_SUM, SPV_PREFIX_SUM_len));
+    descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+    descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             tileCountBuffer);
+    descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             tileOffsetBuffer);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             tileOffsetPartitionBuffer);
+    descriptorSet->build();
+    tileOffsetPipeline->addDescriptorSet(0, descriptorSet);
+    tileOffsetPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(PrefixSumPushConstants));
+    tileOffsetPipeline->build();
+
+    tileSortPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "tile_sort", SPV_TILE_SORT, SPV_TILE_SORT_len));
+    descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+    descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortKBufferEven);
+    descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortVBufferEven);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortKBufferOdd);
+    descriptorSet->bindBufferToDescriptorSet(3, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             sortVBufferOdd);
+    descriptorSet->bindBufferToDescriptorSet(4, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             tileOffsetBuffer);
+    descriptorSet->bindBufferToDescriptorSet(5, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             tileBoundaryBuffer);
+    descriptorSet->build();
+    tileSortPipeline->addDescriptorSet(0, descriptorSet);
+    tileSortPipeline->build();
+}
+
+void Renderer::updateSortKeyLayout() {
+    auto [width, height] = swapchain->swapchainExtent;
+    auto numTiles = ((width + tileWidth - 1) / tileWidth) * ((height + tileHeight - 1) / tileHeight);
+    auto tileBits = std::max<uint32_t>(std::bit_width(numTiles - 1), 1);
+    sortDepthBits = std::clamp(configuration.depthSortBits, 1u, 32u);
+    auto keyBits = tileBits + sortDepthBits;
+    shortSortKeys = keyBits <= 32;
+    numSortPasses = (keyBits + 7) / 8;
+    spdlog::debug("Sorting {} bit keys ({} tile bits, {} depth bits) in {} passes", keyBits, tileBits,
+                  sortDepthBits, numSortPasses);
 }
 
 void Renderer::createRenderPipeline() {
@@ -347,11 +739,11 @@ void Renderer::createRenderPipeline() {
                                         tileBoundaryBuffer);
     inputSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                         sortVBufferEven);
-    // inputSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
-    //                                     sortKBufferOdd);
+    inputSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                        sortVBufferOdd);
     inputSet->build();
 
-    auto outputSet = std::make_shared<DescriptorSet>(context, 1);
+    auto outputSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
     for (auto& image: swapchain->swapchainImages) {
         outputSet->bindImageToDescriptorSet(0, vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute,
                                             image);
@@ -360,18 +752,24 @@ void Renderer::createRenderPipeline() {
     renderPipeline->addDescriptorSet(0, inputSet);
     renderPipeline->addDescriptorSet(1, outputSet);
     renderPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t) * 2);
+    // the workgroup covers one tile
+    renderPipeline->addSpecializationConstant(10, tileWidth);
+    renderPipeline->addSpecializationConstant(11, tileHeight);
     renderPipeline->build();
 }
 
 void Renderer::draw() {
-    auto ret = context->device->waitForFences(inflightFences[0].get(), VK_TRUE, UINT64_MAX);
+    // the other frames in flight keep the GPU busy while this one is recorded
+    auto ret = context->device->waitForFences(inflightFences[currentFrame].get(), VK_TRUE, UINT64_MAX);
     if (ret != vk::Result::eSuccess) {
         throw std::runtime_error("Failed to wait for fence");
     }
-    context->device->resetFences(inflightFences[0].get());
+    if (recordedPreprocessVersions[currentFrame] != 0) {
+        retrieveTimestamps();
+    }
 
     auto res = context->device->acquireNextImageKHR(swapchain->swapchain.get(), UINT64_MAX,
-                                                    swapchain->imageAvailableSemaphores[0].get(),
+                                                    swapchain->imageAvailableSemaphores[currentFrame].get(),
                                                     nullptr, &currentImageIndex);
     if (res == vk::Result::eErrorOutOfDateKHR) {
         recreateSwapchain();
@@ -379,39 +777,84 @@ void Renderer::draw() {
     } else if (res != vk::Result::eSuccess && res != vk::Result::eSuboptimalKHR) {
         throw std::runtime_error("Failed to acquire swapchain image");
     }
+    // only reset once the frame is certain to be submitted
+    context->device->resetFences(inflightFences[currentFrame].get());
 
-startOfRenderLoop:
     handleInput();
 
     updateUniforms();
 
-    auto submitInfo = vk::SubmitInfo{}.setCommandBuffers(preprocessCommandBuffer.get());
-    context->queues[VulkanContext::Queue::COMPUTE].queue.submit(submitInfo, inflightFences[0].get());
+    // the last frame in this slot is complete, its total tells whether the sort buffers overflowed
+    numInstances = totalSumBuffersHost[currentFrame]->readOne<uint32_t>();
+    guiManager.pushTextMetric("instances", numInstances);
+    if (numInstances > scene->getNumVertices() * sortBufferSizeMultiplier) {
+        growSortBuffers(numInstances);
+    }
 
-    ret = context->device->waitForFences(inflightFences[0].get(), VK_TRUE, UINT64_MAX);
-    if (ret != vk::Result::eSuccess) {
-        throw std::runtime_error("Failed to wait for fence");
+    auto numLoadedVertices = scene->getNumLoadedVertices();
+    if (numLoadedVertices != numResidentVertices) {
+        numResidentVertices = numLoadedVertices;
+        preprocessVersion++;
+        renderVersion++;
+    }
+    if (configuration.enableGui && sceneLoader.joinable()) {
+        guiManager.pushTextMetric("loaded splats", numResidentVertices);
+        // paged scenes are converted into their cache before the first page is loaded
+        if (scene->isPaged() && numResidentVertices == 0) {
+            guiManager.pushTextMetric("converted splats", scene->getNumConvertedVertices());
+        }
     }
-    context->device->resetFences(inflightFences[0].get());
 
-    if (!recordRenderCommandBuffer(0)) {
-        goto startOfRenderLoop;
+    if (recordedPreprocessVersions[currentFrame] != preprocessVersion) {
+        recordPreprocessCommandBuffer();
+        recordedPreprocessVersions[currentFrame] = preprocessVersion;
+    }
+
+#ifdef VKGS_ENABLE_METAL
+    // as of the last frame, the count of this one is only known on the GPU
+    bool skipRender = numInstances == 0 && __APPLE__;
+    if (skipRender != renderSkipped) {
+        renderSkipped = skipRender;
+        renderVersion++;
+    }
+#endif
+    // only the GUI is recorded every frame
+    auto renderIndex = renderCommandBufferIndex();
+    if (recordedRenderVersions[renderIndex] != renderVersion) {
+        recordRenderCommandBuffer();
+        recordedRenderVersions[renderIndex] = renderVersion;
+    }
+    std::vector<vk::CommandBuffer> renderCommands{renderCommandBuffers[renderIndex].get()};
+    if (configuration.enableGui) {
+        recordGuiCommandBuffer();
+        renderCommands.push_back(guiCommandBuffers[currentFrame].get());
     }
+
+    // The sort and render passes take their sizes from the GPU, so the frame goes out in one submission. Only the
+    // render part waits for the swapchain image.
     vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eComputeShader;
-    submitInfo = vk::SubmitInfo{}.setWaitSemaphores(swapchain->imageAvailableSemaphores[0].get())
-            .setCommandBuffers(renderCommandBuffer.get())
-            .setSignalSemaphores(renderFinishedSemaphores[0].get())
-            .setWaitDstStageMask(waitStage);
-    context->queues[VulkanContext::Queue::COMPUTE].queue.submit(submitInfo, inflightFences[0].get());
+    std::array<vk::SubmitInfo, 2> submitInfos{
+        vk::SubmitInfo{}.setCommandBuffers(preprocessCommandBuffers[currentFrame].get()),
+        vk::SubmitInfo{}.setWaitSemaphores(swapchain->imageAvailableSemaphores[currentFrame].get())
+                .setCommandBuffers(renderCommands)
+                .setSignalSemaphores(renderFinishedSemaphores[currentFrame].get())
+                .setWaitDstStageMask(waitStage)
+    };
+    {
+        std::lock_guard<std::mutex> lock(context->queueMutex);
+        context->queues[VulkanContext::Queue::COMPUTE].queue.submit(submitInfos, inflightFences[currentFrame].get());
+    }
 
     vk::PresentInfoKHR presentInfo{};
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &renderFinishedSemaphores[0].get();
+    presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame].get();
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = &swapchain->swapchain.get();
     presentInfo.pImageIndices = &currentImageIndex;
+    currentFrame = (currentFrame + 1) % FRAMES_IN_FLIGHT;
 
     try {
+        std::lock_guard<std::mutex> lock(context->queueMutex);
         ret = context->queues[VulkanContext::Queue::PRESENT].queue.presentKHR(presentInfo);
     } catch (vk::OutOfDateKHRError& e) {
         recreateSwapchain();
@@ -442,10 +885,9 @@ void Renderer::run() {
         } else {
             fpsCounter++;
         }
-
-        retrieveTimestamps();
     }
 
+    stopSceneLoader();
     context->device->waitIdle();
 }
 
@@ -453,6 +895,7 @@ void Renderer::stop() {
     // wait till device is idle
     running = false;
 
+    std::lock_guard<std::mutex> lock(context->queueMutex);
     context->device->waitIdle();
 }
 
@@ -463,161 +906,227 @@ void Renderer::createCommandPool() {
     poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
 
     commandPool = context->device->createCommandPoolUnique(poolInfo, nullptr);
+
+    vk::CommandBufferAllocateInfo allocateInfo = {commandPool.get(), vk::CommandBufferLevel::ePrimary, FRAMES_IN_FLIGHT};
+    preprocessCommandBuffers = context->device->allocateCommandBuffersUnique(allocateInfo);
+    guiCommandBuffers = context->device->allocateCommandBuffersUnique(allocateInfo);
+    allocateRenderCommandBuffers();
+}
+
+void Renderer::allocateRenderCommandBuffers() {
+    auto count = FRAMES_IN_FLIGHT * static_cast<uint32_t>(swapchain->swapchainImages.size());
+    renderCommandBuffers.clear();
+    renderCommandBuffers = context->device->allocateCommandBuffersUnique(
+        vk::CommandBufferAllocateInfo{commandPool.get(), vk::CommandBufferLevel::ePrimary, count});
+    recordedRenderVersions.assign(count, 0);
+}
+
+uint32_t Renderer::renderCommandBufferIndex() const {
+    return currentFrame * swapchain->swapchainImages.size() + currentImageIndex;
 }
 
 void Renderer::recordPreprocessCommandBuffer() {
-    spdlog::debug("Recording preprocess command buffer");
-    if (!preprocessCommandBuffer) {
-        vk::CommandBufferAllocateInfo allocateInfo = {commandPool.get(), vk::CommandBufferLevel::ePrimary, 1};
-        auto buffers = context->device->allocateCommandBuffersUnique(allocateInfo);
-        preprocessCommandBuffer = std::move(buffers[0]);
-    }
+    spdlog::debug("Recording preprocess command buffer of frame {}", currentFrame);
+    auto& preprocessCommandBuffer = preprocessCommandBuffers[currentFrame];
     preprocessCommandBuffer->reset();
 
-    auto numGroups = (scene->getNumVertices() + 255) / 256;
+    auto numChunks = (numResidentVertices + GSScene::CHUNK_SIZE - 1) / GSScene::CHUNK_SIZE;
+    // the chunks of a paged scene all have resident bounds and are looked up in the page pool
+    auto numCullChunks = scene->isPaged() && numResidentVertices > 0 ? scene->getNumChunks() : numChunks;
 
     preprocessCommandBuffer->begin(vk::CommandBufferBeginInfo{});
 
-    preprocessCommandBuffer->resetQueryPool(context->queryPool.get(), 0, 12);
+    preprocessCommandBuffer->resetQueryPool(context->queryPool.get(), currentFrame * QUERIES_PER_FRAME,
+                                            QUERIES_PER_FRAME);
+
+    // The transient buffers are shared by the frames in flight, so this frame starts once the last one is done
+    // with them. Only the per frame uniforms and totals can be written while it runs.
+    vk::MemoryBarrier frameBarrier{
+        vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferRead |
+        vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eIndirectCommandRead
+    };
+    preprocessCommandBuffer->pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer |
+        vk::PipelineStageFlagBits::eDrawIndirect, {}, frameBarrier, nullptr, nullptr);
+
+    if (configuration.enableChunkCulling) {
+        // culled chunks are not preprocessed, so their tile counts from earlier frames have to go
+        preprocessCommandBuffer->fillBuffer(tileOverlapBuffer->buffer, 0, VK_WHOLE_SIZE, 0);
+        vk::DispatchIndirectCommand dispatch{0, 1, 1};
+        preprocessCommandBuffer->updateBuffer(preprocessDispatchBuffer->buffer, 0, sizeof(dispatch), &dispatch);
+        Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+                .addBufferBarrier(tileOverlapBuffer, vk::AccessFlagBits::eTransferWrite,
+                                  vk::AccessFlagBits::eShaderWrite)
+                .addBufferBarrier(preprocessDispatchBuffer, vk::AccessFlagBits::eTransferWrite,
+                                  vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite)
+                .build(preprocessCommandBuffer.get(), vk::PipelineStageFlagBits::eTransfer,
+                       vk::PipelineStageFlagBits::eComputeShader);
+
+        chunkCullPipeline->bind(preprocessCommandBuffer, currentFrame, 0);
+        preprocessCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                                timestampQuery("chunk_cull_start"));
+        ChunkCullPushConstants cullConstants{numCullChunks, configuration.lodErrorThreshold};
+        preprocessCommandBuffer->pushConstants(chunkCullPipeline->pipelineLayout.get(),
+                                               vk::ShaderStageFlagBits::eCompute, 0, sizeof(ChunkCullPushConstants),
+                                               &cullConstants);
+        preprocessCommandBuffer->dispatch((numCullChunks + 255) / 256, 1, 1);
+        preprocessCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                                timestampQuery("chunk_cull_end"));
+
+        Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+                .addBufferBarrier(visibleChunksBuffer, vk::AccessFlagBits::eShaderWrite,
+                                  vk::AccessFlagBits::eShaderRead)
+                .addBufferBarrier(preprocessDispatchBuffer, vk::AccessFlagBits::eShaderWrite,
+                                  vk::AccessFlagBits::eIndirectCommandRead)
+                .build(preprocessCommandBuffer.get(), vk::PipelineStageFlagBits::eComputeShader,
+                       vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect);
+        if (scene->isPaged()) {
+            Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+                    .addBufferBarrier(scene->pageRequestBuffer, vk::AccessFlagBits::eShaderWrite,
+                                      vk::AccessFlagBits::eHostRead)
+                    .build(preprocessCommandBuffer.get(), vk::PipelineStageFlagBits::eComputeShader,
+                           vk::PipelineStageFlagBits::eHost);
+        }
+    }
 
-    preprocessPipeline->bind(preprocessCommandBuffer, 0, 0);
+    preprocessPipeline->bind(preprocessCommandBuffer, currentFrame, 0);
     preprocessCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                            queryManager->registerQuery("preprocess_start"));
-    preprocessCommandBuffer->dispatch(numGroups, 1, 1);
+                                            timestampQuery("preprocess_start"));
+    preprocessCommandBuffer->pushConstants(preprocessPipeline->pipelineLayout.get(),
+                                           vk::ShaderStageFlagBits::eCompute, 0,
+                                           sizeof(uint32_t), &numResidentVertices);
+    if (configuration.enableChunkCulling) {
+        preprocessCommandBuffer->dispatchIndirect(preprocessDispatchBuffer->buffer, 0);
+    } else {
+        preprocessCommandBuffer->dispatch(numChunks, 1, 1);
+    }
     tileOverlapBuffer->computeWriteReadBarrier(preprocessCommandBuffer.get());
 
-    vk::BufferCopy copyRegion = {0, 0, tileOverlapBuffer->size};
-    preprocessCommandBuffer->copyBuffer(tileOverlapBuffer->buffer, prefixSumPingBuffer->buffer, 1, &copyRegion);
-
-    prefixSumPingBuffer->computeWriteReadBarrier(preprocessCommandBuffer.get());
-
     preprocessCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                            queryManager->registerQuery("preprocess_end"));
+                                            timestampQuery("preprocess_end"));
 
-    prefixSumPipeline->bind(preprocessCommandBuffer, 0, 0);
+    prefixSumPipeline->bind(preprocessCommandBuffer, currentFrame, 0);
     preprocessCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                            queryManager->registerQuery("prefix_sum_start"));
-    const auto iters = static_cast<uint32_t>(std::ceil(std::log2(static_cast<float>(scene->getNumVertices()))));
-    for (uint32_t timestep = 0; timestep <= iters; timestep++) {
+                                            timestampQuery("prefix_sum_start"));
+    // reduce the partitions, scan their sums in a single workgroup, then scan the partitions from their offsets
+    const auto numPartitions = std::max((numResidentVertices + PREFIX_SUM_PARTITION_SIZE - 1) /
+                                        PREFIX_SUM_PARTITION_SIZE, 1u);
+    const uint32_t prefixSumDispatches[] = {numPartitions, 1, numPartitions};
+    for (uint32_t pass = 0; pass < 3; pass++) {
+        PrefixSumPushConstants prefixSumConstants{pass, numResidentVertices};
         preprocessCommandBuffer->pushConstants(prefixSumPipeline->pipelineLayout.get(),
                                                vk::ShaderStageFlagBits::eCompute, 0,
-                                               sizeof(uint32_t), &timestep);
-        preprocessCommandBuffer->dispatch(numGroups, 1, 1);
-
-        if (timestep % 2 == 0) {
-            prefixSumPongBuffer->computeWriteReadBarrier(preprocessCommandBuffer.get());
-            prefixSumPingBuffer->computeReadWriteBarrier(preprocessCommandBuffer.get());
-        } else {
-            prefixSumPingBuffer->computeWriteReadBarrier(preprocessCommandBuffer.get());
-            prefixSumPongBuffer->computeReadWriteBarrier(preprocessCommandBuffer.get());
+                                               sizeof(PrefixSumPushConstants), &prefixSumConstants);
+        preprocessCommandBuffer->dispatch(prefixSumDispatches[pass], 1, 1);
+        if (pass < 2) {
+            prefixSumPartitionBuffer->computeWriteReadBarrier(preprocessCommandBuffer.get());
         }
     }
 
-    auto totalSumRegion = vk::BufferCopy{(scene->getNumVertices() - 1) * sizeof(uint32_t), 0, sizeof(uint32_t)};
-    if (iters % 2 == 0) {
-        preprocessCommandBuffer->copyBuffer(prefixSumPingBuffer->buffer, totalSumBufferHost->buffer, 1,
+    Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+            .addBufferBarrier(prefixSumBuffer, vk::AccessFlagBits::eShaderWrite,
+                              vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead)
+            .build(preprocessCommandBuffer.get(), vk::PipelineStageFlagBits::eComputeShader,
+                   vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer);
+    if (numResidentVertices > 0) {
+        auto totalSumRegion = vk::BufferCopy{(numResidentVertices - 1) * sizeof(uint32_t), 0, sizeof(uint32_t)};
+        preprocessCommandBuffer->copyBuffer(prefixSumBuffer->buffer, totalSumBuffersHost[currentFrame]->buffer, 1,
                                             &totalSumRegion);
     } else {
-        preprocessCommandBuffer->copyBuffer(prefixSumPongBuffer->buffer, totalSumBufferHost->buffer, 1,
-                                            &totalSumRegion);
+        // the prefix sum wrote nothing, its first element is left over from an earlier frame
+        uint32_t totalSum = 0;
+        preprocessCommandBuffer->updateBuffer(totalSumBuffersHost[currentFrame]->buffer, 0, sizeof(uint32_t),
+                                              &totalSum);
     }
 
+    dispatchArgsPipeline->bind(preprocessCommandBuffer, currentFrame, 0);
+    DispatchArgsPushConstants argsConstants{
+        numResidentVertices, static_cast<uint32_t>(scene->getNumVertices() * sortBufferSizeMultiplier),
+        numRadixSortBlocksPerWorkgroup
+    };
+    preprocessCommandBuffer->pushConstants(dispatchArgsPipeline->pipelineLayout.get(),
+                                           vk::ShaderStageFlagBits::eCompute, 0,
+                                           sizeof(DispatchArgsPushConstants), &argsConstants);
+    preprocessCommandBuffer->dispatch(1, 1, 1);
+    Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+            .addBufferBarrier(sortArgsBuffer, vk::AccessFlagBits::eShaderWrite,
+                              vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eIndirectCommandRead)
+            .build(preprocessCommandBuffer.get(), vk::PipelineStageFlagBits::eComputeShader,
+                   vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect);
+
     preprocessCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                        queryManager->registerQuery("prefix_sum_end"));
+                                        timestampQuery("prefix_sum_end"));
 
     preprocessCommandBuffer->end();
 }
 
 
-bool Renderer::recordRenderCommandBuffer(uint32_t currentFrame) {
-    if (!renderCommandBuffer) {
-        renderCommandBuffer = std::move(context->device->allocateCommandBuffersUnique(
-            vk::CommandBufferAllocateInfo(commandPool.get(), vk::CommandBufferLevel::ePrimary, 1))[0]);
+void Renderer::growSortBuffers(uint32_t numInstances) {
+    auto old = sortBufferSizeMultiplier;
+    while (numInstances > scene->getNumVertices() * sortBufferSizeMultiplier) {
+        sortBufferSizeMultiplier++;
     }
-
-    uint32_t numInstances = totalSumBufferHost->readOne<uint32_t>();
-    // spdlog::debug("Num instances: {}", numInstances);
-    guiManager.pushTextMetric("instances", numInstances);
-    if (numInstances > scene->getNumVertices() * sortBufferSizeMultiplier) {
-        auto old = sortBufferSizeMultiplier;
-        while (numInstances > scene->getNumVertices() * sortBufferSizeMultiplier) {
-            sortBufferSizeMultiplier++;
-        }
-        spdlog::info("Reallocating sort buffers. {} -> {}", old, sortBufferSizeMultiplier);
-        sortKBufferEven->realloc(scene->getNumVertices() * sizeof(uint64_t) * sortBufferSizeMultiplier);
-        sortKBufferOdd->realloc(scene->getNumVertices() * sizeof(uint64_t) * sortBufferSizeMultiplier);
-        sortVBufferEven->realloc(scene->getNumVertices() * sizeof(uint32_t) * sortBufferSizeMultiplier);
-        sortVBufferOdd->realloc(scene->getNumVertices() * sizeof(uint32_t) * sortBufferSizeMultiplier);
-
-        uint32_t globalInvocationSize = scene->getNumVertices() * sortBufferSizeMultiplier /
-                                        numRadixSortBlocksPerWorkgroup;
-        uint32_t remainder = scene->getNumVertices() * sortBufferSizeMultiplier % numRadixSortBlocksPerWorkgroup;
-        globalInvocationSize += remainder > 0 ? 1 : 0;
-
-        auto numWorkgroups = (globalInvocationSize + 256 - 1) / 256;
-
-        sortHistBuffer->realloc(numWorkgroups * 256 * sizeof(uint32_t));
-
-        recordPreprocessCommandBuffer();
-        return false;
+    spdlog::info("Reallocating sort buffers. {} -> {}", old, sortBufferSizeMultiplier);
+    // the other frame in flight may still be sorting
+    {
+        std::lock_guard<std::mutex> lock(context->queueMutex);
+        context->device->waitIdle();
     }
+    sortKBufferEven->realloc(scene->getNumVertices() * sizeof(uint64_t) * sortBufferSizeMultiplier);
+    sortKBufferOdd->realloc(scene->getNumVertices() * sizeof(uint64_t) * sortBufferSizeMultiplier);
+    sortVBufferEven->realloc(scene->getNumVertices() * sizeof(uint32_t) * sortBufferSizeMultiplier);
+    sortVBufferOdd->realloc(scene->getNumVertices() * sizeof(uint32_t) * sortBufferSizeMultiplier);
 
-    renderCommandBuffer->reset({});
-    renderCommandBuffer->begin(vk::CommandBufferBeginInfo{});
-
-#ifdef VKGS_ENABLE_METAL
-    if (numInstances == 0 && __APPLE__) {
-        renderCommandBuffer->end();
-        return true;
-    }
-#endif
-
-    vertexAttributeBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
-
-    const auto iters = static_cast<uint32_t>(std::ceil(std::log2(static_cast<float>(scene->getNumVertices()))));
-    auto numGroups = (scene->getNumVertices() + 255) / 256;
-    preprocessSortPipeline->bind(renderCommandBuffer, 0, iters % 2 == 0 ? 0 : 1);
-    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                            queryManager->registerQuery("preprocess_sort_start"));
-    uint32_t tileX = (swapchain->swapchainExtent.width + 16 - 1) / 16;
-    // assert(tileX == 50);
-    renderCommandBuffer->pushConstants(preprocessSortPipeline->pipelineLayout.get(),
-                                           vk::ShaderStageFlagBits::eCompute, 0,
-                                           sizeof(uint32_t), &tileX);
-    renderCommandBuffer->dispatch(numGroups, 1, 1);
+    uint32_t globalInvocationSize = scene->getNumVertices() * sortBufferSizeMultiplier /
+                                    numRadixSortBlocksPerWorkgroup;
+    uint32_t remainder = scene->getNumVertices() * sortBufferSizeMultiplier % numRadixSortBlocksPerWorkgroup;
+    globalInvocationSize += remainder > 0 ? 1 : 0;
 
-    sortKBufferEven->computeWriteReadBarrier(renderCommandBuffer.get());
-    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                            queryManager->registerQuery("preprocess_sort_end"));
+    auto numWorkgroups = (globalInvocationSize + 256 - 1) / 256;
 
-    // std::cout << "Num instances: " << numInstances << std::endl;
+    sortHistBuffer->realloc(numWorkgroups * 256 * sizeof(uint32_t));
+    if (onesweepSort) {
+        onesweepStatusBuffer->realloc(onesweepStatusSize(8));
+    }
 
-    assert(numInstances <= scene->getNumVertices() * sortBufferSizeMultiplier);
-    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                                queryManager->registerQuery("sort_start"));
-    for (auto i = 0; i < 8; i++) {
-        sortHistPipeline->bind(renderCommandBuffer, 0, i % 2 == 0 ? 0 : 1);
-        auto invocationSize = (numInstances + numRadixSortBlocksPerWorkgroup - 1) / numRadixSortBlocksPerWorkgroup;
-        invocationSize = (invocationSize + 255) / 256;
-
-        RadixSortPushConstants pushConstants{};
-        pushConstants.g_num_elements = numInstances;
-        pushConstants.g_num_blocks_per_workgroup = numRadixSortBlocksPerWorkgroup;
-        pushConstants.g_shift = i * 8;
-        pushConstants.g_num_workgroups = invocationSize;
-        renderCommandBuffer->pushConstants(sortHistPipeline->pipelineLayout.get(),
-                                           vk::ShaderStageFlagBits::eCompute, 0,
-                                           sizeof(RadixSortPushConstants), &pushConstants);
+    // the capacity is baked into the dispatch argument pass, the buffers into the recorded sort
+    preprocessVersion++;
+    renderVersion++;
+}
 
-        renderCommandBuffer->dispatch(invocationSize, 1, 1);
+void Renderer::recordOnesweepSort() {
+    auto& renderCommandBuffer = renderCommandBuffers[renderCommandBufferIndex()];
+    // the histogram pass resets the status of the partitions it dispatches, so only the histograms are cleared here
+    renderCommandBuffer->fillBuffer(onesweepHistBuffer->buffer, 0, VK_WHOLE_SIZE, 0);
+    Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+            .addBufferBarrier(onesweepHistBuffer, vk::AccessFlagBits::eTransferWrite,
+                              vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite)
+            .build(renderCommandBuffer.get(), vk::PipelineStageFlagBits::eTransfer,
+                   vk::PipelineStageFlagBits::eComputeShader);
 
-        sortHistBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
+    // the digits of all passes are counted in one read of the keys
+    auto& histPipeline = shortSortKeys ? shortKeyOnesweepHistPipeline : onesweepHistPipeline;
+    auto& scatterPipeline = shortSortKeys ? shortKeyOnesweepPipeline : onesweepPipeline;
+    OnesweepPushConstants pushConstants{0, numSortPasses};
+    histPipeline->bind(renderCommandBuffer, currentFrame, 0);
+    renderCommandBuffer->pushConstants(histPipeline->pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0,
+                                       sizeof(OnesweepPushConstants), &pushConstants);
+    renderCommandBuffer->dispatchIndirect(sortArgsBuffer->buffer, offsetof(SortArgs, onesweepDispatch));
+    Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+            .addBufferBarrier(onesweepHistBuffer, vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead)
+            .addBufferBarrier(onesweepStatusBuffer, vk::AccessFlagBits::eShaderWrite,
+                              vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite)
+            .build(renderCommandBuffer.get(), vk::PipelineStageFlagBits::eComputeShader,
+                   vk::PipelineStageFlagBits::eComputeShader);
 
-        sortPipeline->bind(renderCommandBuffer, 0, i % 2 == 0 ? 0 : 1);
-        renderCommandBuffer->pushConstants(sortPipeline->pipelineLayout.get(),
-                                           vk::ShaderStageFlagBits::eCompute, 0,
-                                           sizeof(RadixSortPushConstants), &pushConstants);
-        renderCommandBuffer->dispatch(invocationSize, 1, 1);
+    for (uint32_t i = 0; i < numSortPasses; i++) {
+        scatterPipeline->bind(renderCommandBuffer, currentFrame, i % 2 == 0 ? 0 : 1);
+        pushConstants.pass = i;
+        renderCommandBuffer->pushConstants(scatterPipeline->pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute,
+                                           0, sizeof(OnesweepPushConstants), &pushConstants);
+        renderCommandBuffer->dispatchIndirect(sortArgsBuffer->buffer, offsetof(SortArgs, onesweepDispatch));
 
         if (i % 2 == 0) {
             sortKBufferOdd->computeWriteReadBarrier(renderCommandBuffer.get());
@@ -627,33 +1136,34 @@ bool Renderer::recordRenderCommandBuffer(uint32_t currentFrame) {
             sortVBufferEven->computeWriteReadBarrier(renderCommandBuffer.get());
         }
     }
-    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                                queryManager->registerQuery("sort_end"));
+}
 
-    renderCommandBuffer->fillBuffer(tileBoundaryBuffer->buffer, 0, VK_WHOLE_SIZE, 0);
+void Renderer::recordRenderCommandBuffer() {
+    auto& renderCommandBuffer = renderCommandBuffers[renderCommandBufferIndex()];
+    spdlog::debug("Recording render command buffer of frame {} and image {}", currentFrame, currentImageIndex);
+    renderCommandBuffer->reset({});
+    renderCommandBuffer->begin(vk::CommandBufferBeginInfo{});
 
-    Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
-            .addBufferBarrier(tileBoundaryBuffer, vk::AccessFlagBits::eTransferWrite,
-                              vk::AccessFlagBits::eShaderWrite)
-            .build(renderCommandBuffer.get(), vk::PipelineStageFlagBits::eTransfer,
-                   vk::PipelineStageFlagBits::eComputeShader);
+#ifdef VKGS_ENABLE_METAL
+    if (renderSkipped) {
+        renderCommandBuffer->end();
+        return;
+    }
+#endif
 
-    // Since we have 64 bit keys, the sort result is always in the even buffer
-    tileBoundaryPipeline->bind(renderCommandBuffer, 0, 0);
-    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                        queryManager->registerQuery("tile_boundary_start"));
-    renderCommandBuffer->pushConstants(tileBoundaryPipeline->pipelineLayout.get(),
-                                       vk::ShaderStageFlagBits::eCompute, 0,
-                                       sizeof(uint32_t), &numInstances);
-    renderCommandBuffer->dispatch((numInstances + 255) / 256, 1, 1);
+    vertexAttributeBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
 
-    tileBoundaryBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
-    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                        queryManager->registerQuery("tile_boundary_end"));
+    // the option of the buffers that hold the sorted instances
+    uint32_t sortedOption = 0;
+    if (configuration.enableTileSort) {
+        recordTileSort();
+    } else {
+        sortedOption = recordGlobalSort();
+    }
 
-    renderPipeline->bind(renderCommandBuffer, 0, std::vector<uint32_t>{0, currentImageIndex});
+    renderPipeline->bind(renderCommandBuffer, currentFrame, std::vector<uint32_t>{sortedOption, currentImageIndex});
     renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                        queryManager->registerQuery("render_start"));
+                                        timestampQuery("render_start"));
     auto [width, height] = swapchain->swapchainExtent;
     uint32_t constants[2] = {width, height};
     renderCommandBuffer->pushConstants(renderPipeline->pipelineLayout.get(),
@@ -674,7 +1184,7 @@ bool Renderer::recordRenderCommandBuffer(uint32_t currentFrame) {
                                          vk::PipelineStageFlagBits::eComputeShader,
                                          vk::DependencyFlagBits::eByRegion, nullptr, nullptr, imageMemoryBarrier);
 
-    renderCommandBuffer->dispatch((width + 15) / 16, (height + 15) / 16, 1);
+    renderCommandBuffer->dispatch((width + tileWidth - 1) / tileWidth, (height + tileHeight - 1) / tileHeight, 1);
 
     // image layout transition: general -> present
     imageMemoryBarrier.oldLayout = vk::ImageLayout::eGeneral;
@@ -696,24 +1206,185 @@ bool Renderer::recordRenderCommandBuffer(uint32_t currentFrame) {
                                              vk::DependencyFlagBits::eByRegion, nullptr, nullptr, imageMemoryBarrier);
     }
     renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
-                                        queryManager->registerQuery("render_end"));
+                                        timestampQuery("render_end"));
+    renderCommandBuffer->end();
+}
 
-    if (configuration.enableGui) {
-        imguiManager->draw(renderCommandBuffer.get(), currentImageIndex, std::bind(&GUIManager::buildGui, &guiManager));
+void Renderer::recordGuiCommandBuffer() {
+    auto& guiCommandBuffer = guiCommandBuffers[currentFrame];
+    guiCommandBuffer->reset({});
+    guiCommandBuffer->begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
 
-        imageMemoryBarrier.oldLayout = vk::ImageLayout::eColorAttachmentOptimal;
-        imageMemoryBarrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+#ifdef VKGS_ENABLE_METAL
+    if (renderSkipped) {
+        guiCommandBuffer->end();
+        return;
+    }
+#endif
 
-        imageMemoryBarrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
-        imageMemoryBarrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+    imguiManager->draw(guiCommandBuffer.get(), currentImageIndex, std::bind(&GUIManager::buildGui, &guiManager));
 
-        renderCommandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
-                                             vk::PipelineStageFlagBits::eComputeShader,
-                                             vk::DependencyFlagBits::eByRegion, nullptr, nullptr, imageMemoryBarrier);
+    // image layout transition: color attachment -> present
+    vk::ImageMemoryBarrier imageMemoryBarrier{};
+    imageMemoryBarrier.oldLayout = vk::ImageLayout::eColorAttachmentOptimal;
+    imageMemoryBarrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
+    imageMemoryBarrier.image = swapchain->swapchainImages[currentImageIndex]->image;
+    imageMemoryBarrier.subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+    imageMemoryBarrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+    imageMemoryBarrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+    imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    guiCommandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                                      vk::PipelineStageFlagBits::eComputeShader,
+                                      vk::DependencyFlagBits::eByRegion, nullptr, nullptr, imageMemoryBarrier);
+    guiCommandBuffer->end();
+}
+
+uint32_t Renderer::recordGlobalSort() {
+    auto& renderCommandBuffer = renderCommandBuffers[renderCommandBufferIndex()];
+    auto numGroups = (numResidentVertices + 255) / 256;
+    preprocessSortPipeline->bind(renderCommandBuffer, currentFrame, 0);
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                            timestampQuery("preprocess_sort_start"));
+    PreprocessSortPushConstants preprocessSortConstants{
+        (swapchain->swapchainExtent.width + tileWidth - 1) / tileWidth, sortDepthBits, shortSortKeys
+    };
+    renderCommandBuffer->pushConstants(preprocessSortPipeline->pipelineLayout.get(),
+                                           vk::ShaderStageFlagBits::eCompute, 0,
+                                           sizeof(PreprocessSortPushConstants), &preprocessSortConstants);
+    renderCommandBuffer->dispatch(numGroups, 1, 1);
+
+    sortKBufferEven->computeWriteReadBarrier(renderCommandBuffer.get());
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                            timestampQuery("preprocess_sort_end"));
+
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                                timestampQuery("sort_start"));
+    if (onesweepSort) {
+        recordOnesweepSort();
+    } else {
+        // only the passes that cover the key bits, each one moves the keys to the other buffer
+        auto& histPipeline = shortSortKeys ? shortKeySortHistPipeline : sortHistPipeline;
+        auto& scatterPipeline = shortSortKeys ? shortKeySortPipeline : sortPipeline;
+        for (uint32_t i = 0; i < numSortPasses; i++) {
+            histPipeline->bind(renderCommandBuffer, currentFrame, i % 2 == 0 ? 0 : 1);
+            RadixSortPushConstants pushConstants{};
+            pushConstants.g_shift = i * 8;
+            renderCommandBuffer->pushConstants(histPipeline->pipelineLayout.get(),
+                                               vk::ShaderStageFlagBits::eCompute, 0,
+                                               sizeof(RadixSortPushConstants), &pushConstants);
+
+            renderCommandBuffer->dispatchIndirect(sortArgsBuffer->buffer, offsetof(SortArgs, sortDispatch));
+
+            sortHistBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
+
+            scatterPipeline->bind(renderCommandBuffer, currentFrame, i % 2 == 0 ? 0 : 1);
+            renderCommandBuffer->pushConstants(scatterPipeline->pipelineLayout.get(),
+                                               vk::ShaderStageFlagBits::eCompute, 0,
+                                               sizeof(RadixSortPushConstants), &pushConstants);
+            renderCommandBuffer->dispatchIndirect(sortArgsBuffer->buffer, offsetof(SortArgs, sortDispatch));
+
+            if (i % 2 == 0) {
+                sortKBufferOdd->computeWriteReadBarrier(renderCommandBuffer.get());
+                sortVBufferOdd->computeWriteReadBarrier(renderCommandBuffer.get());
+            } else {
+                sortKBufferEven->computeWriteReadBarrier(renderCommandBuffer.get());
+                sortVBufferEven->computeWriteReadBarrier(renderCommandBuffer.get());
+            }
+        }
     }
-    renderCommandBuffer->end();
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                                timestampQuery("sort_end"));
+
+    renderCommandBuffer->fillBuffer(tileBoundaryBuffer->buffer, 0, VK_WHOLE_SIZE, 0);
+
+    Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+            .addBufferBarrier(tileBoundaryBuffer, vk::AccessFlagBits::eTransferWrite,
+                              vk::AccessFlagBits::eShaderWrite)
+            .build(renderCommandBuffer.get(), vk::PipelineStageFlagBits::eTransfer,
+                   vk::PipelineStageFlagBits::eComputeShader);
+
+    // an odd number of passes leaves the sorted keys in the odd buffers
+    const uint32_t sortedOption = numSortPasses % 2;
+    tileBoundaryPipeline->bind(renderCommandBuffer, currentFrame, sortedOption);
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                        timestampQuery("tile_boundary_start"));
+    TileBoundaryPushConstants tileBoundaryConstants{sortDepthBits, shortSortKeys};
+    renderCommandBuffer->pushConstants(tileBoundaryPipeline->pipelineLayout.get(),
+                                       vk::ShaderStageFlagBits::eCompute, 0,
+                                       sizeof(TileBoundaryPushConstants), &tileBoundaryConstants);
+    renderCommandBuffer->dispatchIndirect(sortArgsBuffer->buffer, offsetof(SortArgs, tileBoundaryDispatch));
+
+    tileBoundaryBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                        timestampQuery("tile_boundary_end"));
+
+    return sortedOption;
+}
+
+void Renderer::recordTileSort() {
+    auto& renderCommandBuffer = renderCommandBuffers[renderCommandBufferIndex()];
+    auto [width, height] = swapchain->swapchainExtent;
+    auto tileX = (width + tileWidth - 1) / tileWidth;
+    auto tileY = (height + tileHeight - 1) / tileHeight;
+    auto numGroups = (numResidentVertices + 255) / 256;
 
-    return true;
+    // bucket the instances by tile, the timestamps keep the names of the global sort passes
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                        timestampQuery("preprocess_sort_start"));
+    renderCommandBuffer->fillBuffer(tileCountBuffer->buffer, 0, VK_WHOLE_SIZE, 0);
+    Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+            .addBufferBarrier(tileCountBuffer, vk::AccessFlagBits::eTransferWrite,
+                              vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite)
+            .build(renderCommandBuffer.get(), vk::PipelineStageFlagBits::eTransfer,
+                   vk::PipelineStageFlagBits::eComputeShader);
+
+    tileBucketPipeline->bind(renderCommandBuffer, currentFrame, 0);
+    TileBucketPushConstants bucketConstants{0, tileX};
+    renderCommandBuffer->pushConstants(tileBucketPipeline->pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute,
+                                       0, sizeof(TileBucketPushConstants), &bucketConstants);
+    renderCommandBuffer->dispatch(numGroups, 1, 1);
+    tileCountBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
+
+    tileOffsetPipeline->bind(renderCommandBuffer, currentFrame, 0);
+    const uint32_t numTiles = tileX * tileY;
+    const auto numPartitions = (numTiles + PREFIX_SUM_PARTITION_SIZE - 1) / PREFIX_SUM_PARTITION_SIZE;
+    const uint32_t prefixSumDispatches[] = {numPartitions, 1, numPartitions};
+    for (uint32_t pass = 0; pass < 3; pass++) {
+        PrefixSumPushConstants prefixSumConstants{pass, numTiles};
+        renderCommandBuffer->pushConstants(tileOffsetPipeline->pipelineLayout.get(),
+                                           vk::ShaderStageFlagBits::eCompute, 0,
+                                           sizeof(PrefixSumPushConstants), &prefixSumConstants);
+        renderCommandBuffer->dispatch(prefixSumDispatches[pass], 1, 1);
+        if (pass < 2) {
+            tileOffsetPartitionBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
+        }
+    }
+    tileOffsetBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
+
+    tileBucketPipeline->bind(renderCommandBuffer, currentFrame, 0);
+    bucketConstants.pass = 1;
+    renderCommandBuffer->pushConstants(tileBucketPipeline->pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute,
+                                       0, sizeof(TileBucketPushConstants), &bucketConstants);
+    renderCommandBuffer->dispatch(numGroups, 1, 1);
+    sortKBufferEven->computeWriteReadBarrier(renderCommandBuffer.get());
+    sortVBufferEven->computeWriteReadBarrier(renderCommandBuffer.get());
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                        timestampQuery("preprocess_sort_end"));
+
+    // one workgroup sorts each tile by depth and writes its boundaries
+    tileSortPipeline->bind(renderCommandBuffer, currentFrame, 0);
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                        timestampQuery("sort_start"));
+    renderCommandBuffer->dispatch(tileX, tileY, 1);
+    sortVBufferEven->computeWriteReadBarrier(renderCommandBuffer.get());
+    tileBoundaryBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                        timestampQuery("sort_end"));
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                        timestampQuery("tile_boundary_start"));
+    renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
+                                        timestampQuery("tile_boundary_end"));
 }
 
 void Renderer::updateUniforms() {
@@ -722,6 +1393,7 @@ void Renderer::updateUniforms() {
     data.width = width;
     data.height = height;
     data.camera_position = glm::vec4(camera.position, 1.0f);
+    scene->setCameraPosition(camera.position);
 
     auto rotation = glm::mat4_cast(camera.rotation);
     auto translation = glm::translate(glm::mat4(1.0f), camera.position);
@@ -750,8 +1422,9 @@ void Renderer::updateUniforms() {
     data.proj_mat[3][1] *= -1.0f;
     data.tan_fovx = tan_fovx;
     data.tan_fovy = tan_fovy;
-    uniformBuffer->upload(&data, sizeof(UniformBuffer), 0);
+    uniformBuffers[currentFrame]->upload(&data, sizeof(UniformBuffer), 0);
 }
 
 Renderer::~Renderer() {
+    stopSceneLoader();
 }
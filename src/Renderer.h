@@ -4,6 +4,7 @@
 #define GLM_SWIZZLE
 
 #include <atomic>
+#include <thread>
 #include "3dgs.h"
 
 #include "vulkan/Window.h"
@@ -12,6 +13,7 @@
 #include "vulkan/Swapchain.h"
 #include <glm/gtc/quaternion.hpp>
 
+#include "DeviceTuning.h"
 #include "GUIManager.h"
 #include "vulkan/ImguiManager.h"
 #include "vulkan/QueryManager.h"
@@ -49,11 +51,64 @@ public:
         }
     };
 
+    struct ChunkCullPushConstants {
+        uint32_t num_chunks;
+        float lod_threshold;
+    };
+
+    // values scanned by one workgroup of prefix_sum.comp
+    static constexpr uint32_t PREFIX_SUM_PARTITION_SIZE = 2048;
+
+    // shared memory render.comp keeps for every splat of a batch, with vec3 padded to 16 bytes
+    static constexpr uint32_t RENDER_SHARED_BYTES_PER_SPLAT = 40;
+
+    struct PrefixSumPushConstants {
+        uint32_t pass;
+        uint32_t num_elements;
+    };
+
     struct RadixSortPushConstants {
-        uint32_t g_num_elements; // == NUM_ELEMENTS
         uint32_t g_shift; // (*)
-        uint32_t g_num_workgroups; // == NUMBER_OF_WORKGROUPS as defined in the section above
-        uint32_t g_num_blocks_per_workgroup; // == NUM_BLOCKS_PER_WORKGROUP
+    };
+
+    // keys scattered by one workgroup of the onesweep sort
+    static constexpr uint32_t ONESWEEP_PARTITION_SIZE = 2048;
+
+    struct OnesweepPushConstants {
+        uint32_t pass;
+        uint32_t num_passes;
+    };
+
+    struct PreprocessSortPushConstants {
+        uint32_t tileX;
+        uint32_t depth_bits;
+        uint32_t short_keys;
+    };
+
+    struct TileBoundaryPushConstants {
+        uint32_t depth_bits;
+        uint32_t short_keys;
+    };
+
+    struct TileBucketPushConstants {
+        uint32_t pass;
+        uint32_t tileX;
+    };
+
+    struct DispatchArgsPushConstants {
+        uint32_t num_elements;
+        uint32_t capacity;
+        uint32_t num_blocks_per_workgroup;
+    };
+
+    // written by dispatch_args.comp from the tile overlap total, drives the sort and tile boundary passes
+    struct SortArgs {
+        uint32_t numInstances;
+        uint32_t numSortWorkgroups; // == NUMBER_OF_WORKGROUPS of the radix sort
+        vk::DispatchIndirectCommand sortDispatch;
+        vk::DispatchIndirectCommand tileBoundaryDispatch;
+        uint32_t numSortPartitions;
+        vk::DispatchIndirectCommand onesweepDispatch;
     };
 
     explicit Renderer(VulkanSplatting::RendererConfiguration configuration);
@@ -66,6 +121,16 @@ public:
 
     void retrieveTimestamps();
 
+    // GPU time of the passes of the last frame whose timestamps were read, in ms
+    [[nodiscard]] double getFrameTime() const {
+        return frameTime;
+    }
+
+    // Constants the pipelines were built with
+    [[nodiscard]] DeviceTuning getTuning() const;
+
+    [[nodiscard]] std::string getDeviceKey() const;
+
     void recreateSwapchain();
 
     void draw();
@@ -93,78 +158,176 @@ private:
     std::shared_ptr<QueryManager> queryManager = std::make_shared<QueryManager>();
     GUIManager guiManager {};
 
+    std::shared_ptr<ComputePipeline> chunkCullPipeline;
     std::shared_ptr<ComputePipeline> preprocessPipeline;
     std::shared_ptr<ComputePipeline> renderPipeline;
     std::shared_ptr<ComputePipeline> prefixSumPipeline;
+    std::shared_ptr<ComputePipeline> dispatchArgsPipeline;
     std::shared_ptr<ComputePipeline> preprocessSortPipeline;
     std::shared_ptr<ComputePipeline> sortHistPipeline;
     std::shared_ptr<ComputePipeline> sortPipeline;
+    std::shared_ptr<ComputePipeline> shortKeySortHistPipeline;
+    std::shared_ptr<ComputePipeline> shortKeySortPipeline;
+    std::shared_ptr<ComputePipeline> onesweepHistPipeline;
+    std::shared_ptr<ComputePipeline> onesweepPipeline;
+    std::shared_ptr<ComputePipeline> shortKeyOnesweepHistPipeline;
+    std::shared_ptr<ComputePipeline> shortKeyOnesweepPipeline;
     std::shared_ptr<ComputePipeline> tileBoundaryPipeline;
-
-    std::shared_ptr<Buffer> uniformBuffer;
+    std::shared_ptr<ComputePipeline> tileBucketPipeline;
+    std::shared_ptr<ComputePipeline> tileOffsetPipeline;
+    std::shared_ptr<ComputePipeline> tileSortPipeline;
+
+    // one per frame in flight, the host writes them while the other frames run
+    std::vector<std::shared_ptr<Buffer>> uniformBuffers;
+    std::shared_ptr<Buffer> visibleChunksBuffer;
+    std::shared_ptr<Buffer> preprocessDispatchBuffer;
     std::shared_ptr<Buffer> vertexAttributeBuffer;
     std::shared_ptr<Buffer> tileOverlapBuffer;
-    std::shared_ptr<Buffer> prefixSumPingBuffer;
-    std::shared_ptr<Buffer> prefixSumPongBuffer;
+    std::shared_ptr<Buffer> prefixSumBuffer;
+    std::shared_ptr<Buffer> prefixSumPartitionBuffer;
     std::shared_ptr<Buffer> sortKBufferEven;
     std::shared_ptr<Buffer> sortKBufferOdd;
     std::shared_ptr<Buffer> sortHistBuffer;
-    std::shared_ptr<Buffer> totalSumBufferHost;
+    std::shared_ptr<Buffer> onesweepHistBuffer;
+    // partition counters and chained scan status of the onesweep passes
+    std::shared_ptr<Buffer> onesweepStatusBuffer;
+    // totals of the prefix sum of every frame in flight, the sort buffers are grown from them when they did not fit
+    std::vector<std::shared_ptr<Buffer>> totalSumBuffersHost;
+    std::shared_ptr<Buffer> sortArgsBuffer;
     std::shared_ptr<Buffer> tileBoundaryBuffer;
     std::shared_ptr<Buffer> sortVBufferEven;
     std::shared_ptr<Buffer> sortVBufferOdd;
+    // instances per tile and their inclusive prefix sum for the per tile sort
+    std::shared_ptr<Buffer> tileCountBuffer;
+    std::shared_ptr<Buffer> tileOffsetBuffer;
+    std::shared_ptr<Buffer> tileOffsetPartitionBuffer;
 
     std::shared_ptr<DescriptorSet> inputSet;
 
     std::atomic<bool> running = true;
 
+    std::thread sceneLoader;
+    // vertices the recorded command buffers cover, grows while the scene is streamed in
+    uint32_t numResidentVertices = 0;
+    // tile instances of the last completed frame
+    uint32_t numInstances = 0;
+
+    uint32_t currentFrame = 0;
+    // bumped when the preprocess passes change, every frame re-records its command buffer once it is done with it
+    uint32_t preprocessVersion = 1;
+    std::vector<uint32_t> recordedPreprocessVersions = std::vector<uint32_t>(FRAMES_IN_FLIGHT, 0);
+    // bumped when the sort and render passes change, the same way for the render command buffers
+    uint32_t renderVersion = 1;
+    std::vector<uint32_t> recordedRenderVersions;
+#ifdef VKGS_ENABLE_METAL
+    // the recorded render command buffers skip the frame
+    bool renderSkipped = false;
+#endif
+
     std::vector<vk::UniqueFence> inflightFences;
 
     std::shared_ptr<Swapchain> swapchain;
 
     vk::UniqueCommandPool commandPool;
 
-    vk::UniqueCommandBuffer preprocessCommandBuffer;
-    vk::UniqueCommandBuffer renderCommandBuffer;
+    std::vector<vk::UniqueCommandBuffer> preprocessCommandBuffers;
+    // Sort and render passes of every frame in flight into every swapchain image. They only depend on the
+    // swapchain and the buffer sizes, so they are recorded once and submitted every frame.
+    std::vector<vk::UniqueCommandBuffer> renderCommandBuffers;
+    // GUI of every frame in flight, recorded every frame
+    std::vector<vk::UniqueCommandBuffer> guiCommandBuffers;
 
     uint32_t currentImageIndex;
 
     std::vector<vk::UniqueSemaphore> renderFinishedSemaphores;
 
-#ifdef __APPLE__
-    uint32_t numRadixSortBlocksPerWorkgroup = 256;
-#else
+    // Chosen from the device limits by selectDeviceConstants and baked into the shaders as specialization constants
+    uint32_t tileWidth = 16;
+    uint32_t tileHeight = 16;
     uint32_t numRadixSortBlocksPerWorkgroup = 32;
-#endif
+
+    double frameTime = 0.0;
 
     int fpsCounter = 0;
     std::chrono::high_resolution_clock::time_point lastFpsTime = std::chrono::high_resolution_clock::now();
 
     unsigned int sortBufferSizeMultiplier = 1;
 
+    // sort keys are the tile index above sortDepthBits bits of depth, held in 32 bits if they fit
+    uint32_t sortDepthBits = 32;
+    bool shortSortKeys = false;
+    uint32_t numSortPasses = 8;
+
+    // sort with one global histogram and a chained scan per digit instead of a histogram per digit
+    bool onesweepSort = false;
+    // the sort stored in the tuning of the device, used unless the configuration picks one
+    bool tunedOnesweepSort = false;
+
     void initializeVulkan();
 
+    // Picks the tile size and radix sort blocks per workgroup for the limits of the selected device,
+    // which the configuration can override. A stored tuning of the device and then the configuration replace them.
+    void selectDeviceConstants();
+
     void loadSceneToGPU();
 
+    void stopSceneLoader();
+
     void createPreprocessPipeline();
 
+    void createChunkCullPipeline();
+
     void createPrefixSumPipeline();
 
     void createRadixSortPipeline();
 
+    void createOnesweepSortPipeline();
+
+    // Bytes of onesweepStatusBuffer that numPasses passes over the capacity of the sort buffers use
+    uint64_t onesweepStatusSize(uint32_t numPasses) const;
+
     void createPreprocessSortPipeline();
 
     void createTileBoundaryPipeline();
 
+    void createTileSortPipeline();
+
     void createRenderPipeline();
 
+    // Picks the narrowest sort keys for the tiles of the swapchain and the configured depth precision
+    void updateSortKeyLayout();
+
     void recordPreprocessCommandBuffer();
 
-    bool recordRenderCommandBuffer(uint32_t currentFrame);
+    // Grows the sort buffers to hold numInstances, the frames until then drop the instances that do not fit
+    void growSortBuffers(uint32_t numInstances);
+
+    // Allocates the render command buffers for the images of the swapchain
+    void allocateRenderCommandBuffers();
+
+    // Index of the render command buffer of the current frame and swapchain image
+    uint32_t renderCommandBufferIndex() const;
+
+    void recordRenderCommandBuffer();
+
+    void recordGuiCommandBuffer();
+
+    // Records the global sort of all tile instances and the tile boundary pass, returns the descriptor option of
+    // the buffers that hold the sorted instances
+    uint32_t recordGlobalSort();
+
+    // Records the onesweep passes, which leave the keys in the same buffers as the radix sort
+    void recordOnesweepSort();
+
+    // Records the per tile sort, which leaves the instances in the even buffers
+    void recordTileSort();
 
     void createCommandPool();
 
     void updateUniforms();
+
+    // Id of a timestamp query in the range of the current frame
+    uint32_t timestampQuery(const std::string& name);
 };
 
 
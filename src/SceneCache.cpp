@@ -0,0 +1,173 @@
+#include "SceneCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "spdlog/spdlog.h"
+
+static constexpr char MAGIC[8] = {'G', 'S', 'C', 'A', 'C', 'H', 'E', '\0'};
+// sections start on a boundary that suits both memcpy and Vulkan copy offsets
+static constexpr uint64_t SECTION_ALIGNMENT = 256;
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+std::string SceneCache::pathFor(const std::string& sceneFilename) {
+    return std::filesystem::path(sceneFilename).replace_extension(".gscache").string();
+}
+
+void SceneCache::fingerprintSource(const std::string& sceneFilename, Header& header) {
+    header.sourceSize = std::filesystem::file_size(sceneFilename);
+    header.sourceModificationTime = static_cast<int64_t>(
+        std::filesystem::last_write_time(sceneFilename).time_since_epoch().count());
+}
+
+std::unique_ptr<SceneCache> SceneCache::open(const std::string& sceneFilename, uint64_t optionsHash) {
+    auto path = pathFor(sceneFilename);
+    std::error_code error;
+    if (!std::filesystem::exists(path, error)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<SceneCache> cache;
+    try {
+        cache = std::make_unique<SceneCache>(path);
+    } catch (const std::exception& e) {
+        spdlog::warn("Could not open scene cache {}: {}", path, e.what());
+        return nullptr;
+    }
+
+    auto& mapping = cache->mapping;
+    if (mapping.size() < sizeof(Header)) {
+        spdlog::info("Ignoring truncated scene cache {}", path);
+        return nullptr;
+    }
+
+    Header expected{};
+    fingerprintSource(sceneFilename, expected);
+    cache->header = reinterpret_cast<const Header *>(mapping.data());
+    auto header = cache->header;
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION) {
+        spdlog::info("Ignoring scene cache {} from another version", path);
+        return nullptr;
+    }
+    if (header->optionsHash != optionsHash) {
+        spdlog::info("Ignoring scene cache {} built with other loader options", path);
+        return nullptr;
+    }
+    if (header->sourceSize != expected.sourceSize ||
+        header->sourceModificationTime != expected.sourceModificationTime) {
+        spdlog::info("Ignoring stale scene cache {}", path);
+        return nullptr;
+    }
+
+    auto tableEnd = sizeof(Header) + header->numSections * sizeof(SectionEntry);
+    if (mapping.size() < tableEnd) {
+        spdlog::info("Ignoring truncated scene cache {}", path);
+        return nullptr;
+    }
+    cache->sections.resize(header->numSections);
+    memcpy(cache->sections.data(), mapping.data() + sizeof(Header), header->numSections * sizeof(SectionEntry));
+    for (auto& entry: cache->sections) {
+        if (entry.offset + entry.size > mapping.size()) {
+            spdlog::info("Ignoring truncated scene cache {}", path);
+            return nullptr;
+        }
+    }
+
+    return cache;
+}
+
+bool SceneCache::has(Section section) const {
+    return std::any_of(sections.begin(), sections.end(), [section](const SectionEntry& entry) {
+        return entry.section == section;
+    });
+}
+
+std::span<const char> SceneCache::get(Section section) const {
+    for (auto& entry: sections) {
+        if (entry.section == section) {
+            return {mapping.data() + entry.offset, entry.size};
+        }
+    }
+    throw std::runtime_error("Scene cache has no section " + std::to_string(static_cast<uint32_t>(section)));
+}
+
+SceneCache::Writer::Writer(const std::string& sceneFilename, uint64_t optionsHash, uint64_t numVertices)
+    : path(pathFor(sceneFilename)), temporaryPath(pathFor(sceneFilename) + ".tmp") {
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.optionsHash = optionsHash;
+    header.numVertices = numVertices;
+    fingerprintSource(sceneFilename, header);
+
+    file.open(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Could not create scene cache " + temporaryPath);
+    }
+}
+
+void SceneCache::Writer::reserve(Section section, uint64_t size) {
+    if (end != 0) {
+        throw std::runtime_error("Scene cache sections have to be reserved before writing");
+    }
+    sections.push_back({section, 0, 0, size});
+}
+
+const SceneCache::SectionEntry& SceneCache::Writer::find(Section section) const {
+    for (auto& entry: sections) {
+        if (entry.section == section) {
+            return entry;
+        }
+    }
+    throw std::runtime_error("Scene cache section was not reserved");
+}
+
+void SceneCache::Writer::layout() {
+    if (end != 0) {
+        return;
+    }
+    // the sections follow the header and section table
+    end = alignUp(sizeof(Header) + sections.size() * sizeof(SectionEntry), SECTION_ALIGNMENT);
+    for (auto& entry: sections) {
+        entry.offset = end;
+        end = alignUp(end + entry.size, SECTION_ALIGNMENT);
+    }
+}
+
+void SceneCache::Writer::write(Section section, uint64_t offset, const void* data, uint64_t size) {
+    layout();
+    auto& entry = find(section);
+    if (offset + size > entry.size) {
+        throw std::runtime_error("Scene cache section overflow");
+    }
+    file.seekp(static_cast<std::streamoff>(entry.offset + offset));
+    file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+}
+
+void SceneCache::Writer::commit() {
+    layout();
+    header.numSections = sections.size();
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char *>(sections.data()),
+               static_cast<std::streamsize>(sections.size() * sizeof(SectionEntry)));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Could not write scene cache " + temporaryPath);
+    }
+
+    std::filesystem::rename(temporaryPath, path);
+    committed = true;
+}
+
+SceneCache::Writer::~Writer() {
+    if (!committed) {
+        file.close();
+        std::error_code error;
+        std::filesystem::remove(temporaryPath, error);
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef SCENECACHE_H
+#define SCENECACHE_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Preprocessed scene stored next to its source file. The sections hold the data exactly as it is laid out on the
+// GPU, so loading a cached scene is a copy through the staging ring. A cache is stale if the version, the loader
+// options or the size / modification time of the source file do not match.
+class SceneCache {
+public:
+    static constexpr uint32_t VERSION = 3;
+
+    enum class Section : uint32_t {
+        VERTICES = 0,
+        COV3D = 1,
+        // small struct defined by the writer, e.g. the format of the other sections
+        METADATA = 2,
+        // bounds and LOD hierarchy of the splat chunks culled by the renderer
+        CHUNKS = 3,
+    };
+
+    struct SectionEntry {
+        Section section;
+        uint32_t reserved;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t numSections;
+        uint64_t optionsHash;
+        uint64_t numVertices;
+        uint64_t sourceSize;
+        int64_t sourceModificationTime;
+    };
+
+    class Writer {
+    public:
+        Writer(const std::string& sceneFilename, uint64_t optionsHash, uint64_t numVertices);
+
+        void reserve(Section section, uint64_t size);
+
+        void write(Section section, uint64_t offset, const void* data, uint64_t size);
+
+        // Writes the header and moves the file into place. Without a commit the partial file is discarded.
+        void commit();
+
+        ~Writer();
+
+    private:
+        std::string path;
+        std::string temporaryPath;
+        std::ofstream file;
+        Header header{};
+        std::vector<SectionEntry> sections;
+        uint64_t end = 0;
+        bool committed = false;
+
+        void layout();
+
+        const SectionEntry& find(Section section) const;
+    };
+
+    static std::string pathFor(const std::string& sceneFilename);
+
+    // Returns nullptr if there is no valid cache for the scene
+    static std::unique_ptr<SceneCache> open(const std::string& sceneFilename, uint64_t optionsHash);
+
+    explicit SceneCache(const std::string& path) : mapping(path) {}
+
+    [[nodiscard]] uint64_t getNumVertices() const {
+        return header->numVertices;
+    }
+
+    [[nodiscard]] bool has(Section section) const;
+
+    [[nodiscard]] std::span<const char> get(Section section) const;
+
+private:
+    MappedFile mapping;
+    const Header* header = nullptr;
+    std::vector<SectionEntry> sections;
+
+    static void fingerprintSource(const std::string& sceneFilename, Header& header);
+};
+
+
+#endif //SCENECACHE_H
@@ -0,0 +1,87 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <exception>
+
+ThreadPool::ThreadPool(size_t numThreads) {
+    numThreads = std::max<size_t>(numThreads, 1);
+    workers.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto& worker: workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body) {
+    if (count == 0) {
+        return;
+    }
+
+    auto numSlices = std::min(count, workers.size());
+    if (numSlices == 1) {
+        body(0, count);
+        return;
+    }
+
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    size_t remaining = numSlices;
+    std::exception_ptr exception;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t slice = 0; slice < numSlices; slice++) {
+            auto begin = count * slice / numSlices;
+            auto end = count * (slice + 1) / numSlices;
+            tasks.emplace_back([&, begin, end] {
+                std::exception_ptr sliceException;
+                try {
+                    body(begin, end);
+                } catch (...) {
+                    sliceException = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> doneLock(doneMutex);
+                if (sliceException && !exception) {
+                    exception = sliceException;
+                }
+                if (--remaining == 0) {
+                    doneCondition.notify_one();
+                }
+            });
+        }
+    }
+    condition.notify_all();
+
+    std::unique_lock<std::mutex> doneLock(doneMutex);
+    doneCondition.wait(doneLock, [&] { return remaining == 0; });
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
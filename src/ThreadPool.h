@@ -0,0 +1,44 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t numThreads = std::thread::hardware_concurrency());
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool(ThreadPool &&) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(ThreadPool &&) = delete;
+
+    ~ThreadPool();
+
+    [[nodiscard]] size_t size() const {
+        return workers.size();
+    }
+
+    // Splits [0, count) into contiguous slices, one per worker, and blocks until all of them are done.
+    // The first exception thrown by a slice is rethrown on the calling thread.
+    void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body);
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+
+    void workerLoop();
+};
+
+
+#endif //THREADPOOL_H
@@ -1,6 +1,11 @@
-#define TILE_WIDTH 16
-#define TILE_HEIGHT 16
+// Renderer::tileWidth and Renderer::tileHeight, chosen for the device
+layout (constant_id = 10) const uint TILE_WIDTH = 16;
+layout (constant_id = 11) const uint TILE_HEIGHT = 16;
 #define SH_MAX_COEFFS 48
+// splats per culling chunk, GSScene::CHUNK_SIZE
+#define CHUNK_SIZE 256
+// chunks per page of paged scenes, GSScene::PAGE_CHUNKS
+#define PAGE_CHUNKS 16
 
 #ifdef DEBUG
 #extension GL_EXT_debug_printf : enable
@@ -48,6 +53,52 @@ struct VertexAttribute {
     uint magic;
 };
 
+// Sort keys hold the tile index above depth_bits bits of depth, see Renderer::updateSortKeyLayout. Keys of up to
+// 32 bits are stored in one uint, longer ones in two with the low word first.
+// near plane of preprocess, the depth keys start there
+#define DEPTH_KEY_NEAR 0.2
+// float bits of depths from the near plane to about 1e8 relative to the near plane
+#define DEPTH_KEY_RANGE_BITS 28
+
+uint depthKey(float depth, uint depth_bits) {
+    if (depth_bits >= 32) {
+        return floatBitsToUint(depth);
+    }
+    // positive floats order like their bits, so the top bits above the near plane keep the order
+    uint relative = floatBitsToUint(max(depth, DEPTH_KEY_NEAR)) - floatBitsToUint(DEPTH_KEY_NEAR);
+    uint shift = DEPTH_KEY_RANGE_BITS - min(depth_bits, DEPTH_KEY_RANGE_BITS);
+    return min(relative >> shift, (1u << depth_bits) - 1u);
+}
+
+// The power of a splat at which the render pass drops its alpha below 1/255, at most 3 sigma
+float powerCutoff(float opacity) {
+    return min(4.5, log(255.0 * opacity));
+}
+
+// Whether the pixels of a tile come within the cutoff of a splat, i.e. the ellipse of its conic touches the tile. Has
+// to give the same answer wherever the instances of a splat are counted or emitted, hence precise.
+bool splatOverlapsTile(vec2 uv, vec3 conic, float cutoff, uvec2 tile) {
+    precise vec2 rect_min = vec2(tile * uvec2(TILE_WIDTH, TILE_HEIGHT)) - uv;
+    precise vec2 rect_max = rect_min + vec2(TILE_WIDTH - 1, TILE_HEIGHT - 1);
+    if (all(lessThanEqual(rect_min, vec2(0.0))) && all(greaterThanEqual(rect_max, vec2(0.0)))) {
+        return true;
+    }
+
+    // otherwise the closest pixel is on an edge, where the quadratic form is smallest at the clamped vertex
+    precise float q = 1e30;
+    for (uint i = 0; i < 2; i++) {
+        precise float x = i == 0 ? rect_min.x : rect_max.x;
+        precise float y = clamp(-conic.y * x / conic.z, rect_min.y, rect_max.y);
+        q = min(q, conic.x * x * x + 2.0 * conic.y * x * y + conic.z * y * y);
+    }
+    for (uint i = 0; i < 2; i++) {
+        precise float y = i == 0 ? rect_min.y : rect_max.y;
+        precise float x = clamp(-conic.y * y / conic.x, rect_min.x, rect_max.x);
+        q = min(q, conic.x * x * x + 2.0 * conic.y * x * y + conic.z * y * y);
+    }
+    return 0.5 * q <= cutoff;
+}
+
 mat3 rotationFromQuaternion(vec4 q) {
     float qx = q.y;
     float qy = q.z;
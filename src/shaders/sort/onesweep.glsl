@@ -0,0 +1,167 @@
+// Body of onesweep.comp and onesweep32.comp, which define BITS to the width of the keys. One pass scatters the keys
+// by one digit in the style of Onesweep (Adinets and Merrill, 2022): the offsets of the digits come from the
+// histogram of onesweep_hist.comp, the offsets of a partition within them from a chained scan over the partitions
+// before it. Partitions wait on earlier ones, which needs forward progress of the workgroups that run already.
+#define WORKGROUP_SIZE 256// assert WORKGROUP_SIZE == RADIX_SORT_BINS
+#define RADIX_SORT_BINS 256U
+#define ITEMS_PER_THREAD 8
+// Renderer::ONESWEEP_PARTITION_SIZE
+#define PARTITION_SIZE (WORKGROUP_SIZE * ITEMS_PER_THREAD)
+#define MAX_PASSES 8
+
+// partition status words, a flag in the upper two bits above a count
+#define FLAG_NOT_READY 0U
+#define FLAG_AGGREGATE (1U << 30)
+#define FLAG_PREFIX (2U << 30)
+#define FLAG_MASK (3U << 30)
+#define VALUE_MASK (FLAG_AGGREGATE - 1)
+
+#if BITS == 64
+    #define key_t uint64_t
+#else
+    #define key_t uint
+#endif
+
+layout (local_size_x = WORKGROUP_SIZE) in;
+
+layout (push_constant, std430) uniform PushConstants {
+    uint g_pass;
+    uint g_num_passes;
+};
+
+layout (std430, set = 0, binding = 0) readonly buffer elements_in {
+    key_t g_elements_in[];
+};
+
+layout (std430, set = 0, binding = 1) writeonly buffer elements_out {
+    key_t g_elements_out[];
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer payload_in {
+    uint g_payload_in[];
+};
+
+layout (std430, set = 0, binding = 3) writeonly buffer payload_out {
+    uint g_payload_out[];
+};
+
+// [histogram_of_pass_0 | histogram_of_pass_1 | ... ]
+layout (std430, set = 0, binding = 4) readonly buffer histograms {
+    uint g_histograms[];
+};
+
+// Renderer::SortArgs, written on the GPU by dispatch_args.comp
+layout (std430, set = 0, binding = 5) readonly buffer sort_args {
+    uint g_num_elements;
+    uint g_num_workgroups;
+    uint g_sort_dispatch[3];
+    uint g_tile_boundary_dispatch[3];
+    uint g_num_partitions;
+};
+
+// reset by onesweep_hist.glsl: the partitions handed out per pass, then the status of every bin of every
+// partition of every pass
+layout (std430, set = 0, binding = 6) coherent buffer partition_status {
+    uint g_partition_counters[MAX_PASSES];
+    uint g_status[];
+};
+
+shared uint partition_index;
+shared uint[RADIX_SORT_BINS] partition_histogram;
+shared uint[RADIX_SORT_BINS] global_offsets;
+shared uint bin_flags[RADIX_SORT_BINS][WORKGROUP_SIZE / 32];
+
+#include "../workgroup_scan.glsl"
+
+void main() {
+    uint lID = gl_LocalInvocationID.x;
+
+    // partitions are handed out in the order the workgroups start, so the ones waited on are running already
+    if (lID == 0) {
+        partition_index = atomicAdd(g_partition_counters[g_pass], 1U);
+    }
+    partition_histogram[lID] = 0U;
+    barrier();
+    const uint partition = partition_index;
+    const uint partition_start = partition * PARTITION_SIZE;
+    const uint shift = g_pass * 8;
+
+    // the partition is read once and kept in registers
+    key_t elements[ITEMS_PER_THREAD];
+    uint payloads[ITEMS_PER_THREAD];
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        uint elementId = partition_start + i * WORKGROUP_SIZE + lID;
+        if (elementId < g_num_elements) {
+            elements[i] = g_elements_in[elementId];
+            payloads[i] = g_payload_in[elementId];
+            atomicAdd(partition_histogram[uint(elements[i] >> shift) & (RADIX_SORT_BINS - 1)], 1U);
+        }
+    }
+
+    // the offset of every digit over all keys
+    uint total;
+    const uint digit_offset = workgroupExclusiveAdd(g_histograms[g_pass * RADIX_SORT_BINS + lID], total);
+
+    // publish the count of the bin, the first partition knows its prefix already
+    const uint bin_count = partition_histogram[lID];
+    const uint status_base = g_pass * g_num_partitions * RADIX_SORT_BINS + lID;
+    const uint status_index = status_base + partition * RADIX_SORT_BINS;
+    atomicExchange(g_status[status_index], (partition == 0 ? FLAG_PREFIX : FLAG_AGGREGATE) | bin_count);
+
+    // look back over the earlier partitions until one of them knows its prefix
+    uint exclusive = 0;
+    uint lookback = partition;
+    while (lookback > 0) {
+        const uint status = atomicOr(g_status[status_base + (lookback - 1) * RADIX_SORT_BINS], 0U);
+        if ((status & FLAG_MASK) == FLAG_NOT_READY) {
+            continue;
+        }
+        exclusive += status & VALUE_MASK;
+        if ((status & FLAG_MASK) == FLAG_PREFIX) {
+            break;
+        }
+        lookback--;
+    }
+    if (partition > 0) {
+        atomicExchange(g_status[status_index], FLAG_PREFIX | (exclusive + bin_count));
+    }
+    global_offsets[lID] = digit_offset + exclusive;
+
+    // scatter block by block, the bin flags rank the keys of a block like in radix_sort.glsl
+    const uint flags_bin = lID / 32;
+    const uint flags_bit = 1U << (lID % 32);
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        for (uint j = 0; j < WORKGROUP_SIZE / 32; j++) {
+            bin_flags[lID][j] = 0U;
+        }
+        barrier();
+
+        uint elementId = partition_start + i * WORKGROUP_SIZE + lID;
+        uint binID = 0;
+        uint binOffset = 0;
+        if (elementId < g_num_elements) {
+            binID = uint(elements[i] >> shift) & (RADIX_SORT_BINS - 1);
+            binOffset = global_offsets[binID];
+            atomicAdd(bin_flags[binID][flags_bin], flags_bit);
+        }
+        barrier();
+
+        if (elementId < g_num_elements) {
+            uint prefix = 0;
+            uint count = 0;
+            for (uint j = 0; j < WORKGROUP_SIZE / 32; j++) {
+                const uint bits = bin_flags[binID][j];
+                const uint full_count = bitCount(bits);
+                prefix += (j < flags_bin) ? full_count : 0U;
+                prefix += (j == flags_bin) ? bitCount(bits & (flags_bit - 1)) : 0U;
+                count += full_count;
+            }
+            g_elements_out[binOffset + prefix] = elements[i];
+            g_payload_out[binOffset + prefix] = payloads[i];
+            if (prefix == count - 1) {
+                atomicAdd(global_offsets[binID], count);
+            }
+        }
+        barrier();
+    }
+}
@@ -0,0 +1,83 @@
+// Body of onesweep_hist.comp and onesweep_hist32.comp, which define BITS to the width of the keys. Counts the digits
+// of every sort pass in a single read of the keys, the onesweep scatter passes then only have to scan their digit.
+#define WORKGROUP_SIZE 256
+#define RADIX_SORT_BINS 256U
+#define ITEMS_PER_THREAD 8
+// Renderer::ONESWEEP_PARTITION_SIZE
+#define PARTITION_SIZE (WORKGROUP_SIZE * ITEMS_PER_THREAD)
+#define MAX_PASSES (BITS / 8)
+
+#if BITS == 64
+    #define key_t uint64_t
+#else
+    #define key_t uint
+#endif
+
+layout (local_size_x = WORKGROUP_SIZE) in;
+
+layout (push_constant, std430) uniform PushConstants {
+    uint g_pass;
+    uint g_num_passes;
+};
+
+layout (std430, set = 0, binding = 0) readonly buffer elements_in {
+    key_t g_elements_in[];
+};
+
+// [histogram_of_pass_0 | histogram_of_pass_1 | ... ], cleared before the dispatch
+layout (std430, set = 0, binding = 1) buffer histograms {
+    uint g_histograms[];
+};
+
+// Renderer::SortArgs, written on the GPU by dispatch_args.comp
+layout (std430, set = 0, binding = 2) readonly buffer sort_args {
+    uint g_num_elements;
+    uint g_num_workgroups;
+    uint g_sort_dispatch[3];
+    uint g_tile_boundary_dispatch[3];
+    uint g_num_partitions;
+};
+
+// the partition counters and the status words of onesweep.glsl, reset here for the partitions that are dispatched
+layout (std430, set = 0, binding = 3) writeonly buffer partition_status {
+    uint g_partition_counters[MAX_PASSES];
+    uint g_status[];
+};
+
+shared uint[MAX_PASSES * RADIX_SORT_BINS] histogram;
+
+void main() {
+    uint lID = gl_LocalInvocationID.x;
+    uint partition_start = gl_WorkGroupID.x * PARTITION_SIZE;
+
+    // every workgroup marks the bins of its partition not ready in all passes, one bin per invocation
+    for (uint pass = 0; pass < g_num_passes; pass++) {
+        g_status[(pass * g_num_partitions + gl_WorkGroupID.x) * RADIX_SORT_BINS + lID] = 0U;
+    }
+    if (gl_WorkGroupID.x == 0 && lID < MAX_PASSES) {
+        g_partition_counters[lID] = 0U;
+    }
+
+    for (uint i = lID; i < MAX_PASSES * RADIX_SORT_BINS; i += WORKGROUP_SIZE) {
+        histogram[i] = 0U;
+    }
+    barrier();
+
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        uint elementId = partition_start + i * WORKGROUP_SIZE + lID;
+        if (elementId < g_num_elements) {
+            const key_t element = g_elements_in[elementId];
+            for (uint pass = 0; pass < g_num_passes; pass++) {
+                const uint bin = uint(element >> (pass * 8)) & (RADIX_SORT_BINS - 1);
+                atomicAdd(histogram[pass * RADIX_SORT_BINS + bin], 1U);
+            }
+        }
+    }
+    barrier();
+
+    for (uint i = lID; i < g_num_passes * RADIX_SORT_BINS; i += WORKGROUP_SIZE) {
+        if (histogram[i] > 0) {
+            atomicAdd(g_histograms[i], histogram[i]);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/**
+* VkRadixSort written by Mirco Werner: https://github.com/MircoWerner/VkRadixSort
+* Based on implementation of Intel's Embree: https://github.com/embree/embree/blob/v4.0.0-ploc/kernels/rthwif/builder/gpu/sort.h
+*/
+
+/**
+* This shader is modified from the original to support 64-bit k-v pairs.
+* The license of the original code is as follows:
+
+    MIT License
+
+    Copyright (c) 2023 Mirco Werner
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+*/
+
+// Body of hist.comp and hist32.comp, which define BITS to the width of the keys
+#define WORKGROUP_SIZE 256 // assert WORKGROUP_SIZE >= RADIX_SORT_BINS
+#define RADIX_SORT_BINS 256U
+
+#if BITS == 64
+    #define key_t uint64_t
+#else
+    #define key_t uint
+#endif
+
+layout (local_size_x = WORKGROUP_SIZE) in;
+
+layout (push_constant, std430) uniform PushConstants {
+    uint g_shift;
+};
+
+// Renderer::numRadixSortBlocksPerWorkgroup
+layout (constant_id = 1) const uint NUM_BLOCKS_PER_WORKGROUP = 32;
+
+// written on the GPU by dispatch_args.comp, the passes are dispatched indirectly with g_num_workgroups groups
+layout (std430, set = 0, binding = 2) readonly buffer sort_args {
+    uint g_num_elements;
+    uint g_num_workgroups;
+};
+
+layout (std430, set = 0, binding = 0) buffer elements_in {
+    key_t g_elements_in[];
+};
+
+layout (std430, set = 0, binding = 1) buffer histograms {
+// [histogram_of_workgroup_0 | histogram_of_workgroup_1 | ... ]
+    uint g_histograms[]; // |g_histograms| = RADIX_SORT_BINS * #WORKGROUPS
+};
+
+shared uint[RADIX_SORT_BINS] histogram;
+
+void main() {
+    uint gID = gl_GlobalInvocationID.x;
+    uint lID = gl_LocalInvocationID.x;
+    uint wID = gl_WorkGroupID.x;
+
+    // initialize histogram
+    if (lID < RADIX_SORT_BINS) {
+        histogram[lID] = 0U;
+    }
+    barrier();
+
+    for (uint index = 0; index < NUM_BLOCKS_PER_WORKGROUP; index++) {
+        uint elementId = wID * NUM_BLOCKS_PER_WORKGROUP * WORKGROUP_SIZE + index * WORKGROUP_SIZE + lID;
+        if (elementId < g_num_elements) {
+            // determine the bin
+            const uint bin = uint(g_elements_in[elementId] >> g_shift) & (RADIX_SORT_BINS - 1);
+            // increment the histogram
+            atomicAdd(histogram[bin], 1U);
+        }
+    }
+    barrier();
+
+    if (lID < RADIX_SORT_BINS) {
+        g_histograms[RADIX_SORT_BINS * wID + lID] = histogram[lID];
+    }
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+// Decoding of the splat storage formats written by GSScene. The splats are read through four word-addressed
+// streams in set 0, binding 1 is left to the covariances. With the interleaved layout all streams are bound to the
+// same buffer and read at an offset into the vertex record, with SOA_LAYOUT every stream has a buffer of its own.
+//
+// fp32 record (GSScene::Vertex): position.xyzw, scale.xyz + opacity, rotation.wxyz, rgb of each SH coefficient
+// compact record (GSScene::CompactVertex):
+//   0-2  position.xyz as fp32
+//   3-4  scale.xyz and opacity as fp16
+//   5-6  rotation as fp16
+//   7-8  SH DC rgb as fp16, followed by the fp16 scale of the higher bands
+//   9-   rgb of the higher band SH coefficients as signed 8 bit, relative to that scale
+// Both records end after the coefficients of SH_DEGREE. Position streams only hold xyz.
+
+layout (constant_id = 0) const bool COMPACT_STORAGE = false;
+layout (constant_id = 1) const uint SH_DEGREE = 3;
+layout (constant_id = 2) const bool SOA_LAYOUT = false;
+
+const uint SH_COEFFICIENTS = (SH_DEGREE + 1) * (SH_DEGREE + 1);
+const uint VERTEX_WORDS = COMPACT_STORAGE
+                          ? 9 + ((SH_COEFFICIENTS - 1) * 3 + 3) / 4
+                          : 12 + SH_COEFFICIENTS * 3;
+
+// word offset of each stream in the record
+const uint SCALE_OPACITY_OFFSET = COMPACT_STORAGE ? 3 : 4;
+const uint ROTATION_OFFSET = COMPACT_STORAGE ? 5 : 8;
+const uint SH_OFFSET = COMPACT_STORAGE ? 7 : 12;
+
+const uint POSITION_STRIDE = SOA_LAYOUT ? 3 : VERTEX_WORDS;
+const uint SCALE_OPACITY_STRIDE = SOA_LAYOUT ? ROTATION_OFFSET - SCALE_OPACITY_OFFSET : VERTEX_WORDS;
+const uint ROTATION_STRIDE = SOA_LAYOUT ? SH_OFFSET - ROTATION_OFFSET : VERTEX_WORDS;
+const uint SH_STRIDE = SOA_LAYOUT ? VERTEX_WORDS - SH_OFFSET : VERTEX_WORDS;
+
+#define COV3D_WORDS 6
+#define COMPACT_COV3D_WORDS 4
+
+layout (std430, set = 0, binding = 0) readonly buffer Positions {
+    uint position_words[];
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer ScaleOpacities {
+    uint scale_opacity_words[];
+};
+
+layout (std430, set = 0, binding = 3) readonly buffer Rotations {
+    uint rotation_words[];
+};
+
+layout (std430, set = 0, binding = 4) readonly buffer SphericalHarmonics {
+    uint sh_words[];
+};
+
+vec4 load_position(uint index) {
+    uint base = index * POSITION_STRIDE;
+    return vec4(uintBitsToFloat(uvec3(position_words[base], position_words[base + 1], position_words[base + 2])), 1.0);
+}
+
+vec4 load_scale_opacity(uint index) {
+    uint base = index * SCALE_OPACITY_STRIDE + (SOA_LAYOUT ? 0 : SCALE_OPACITY_OFFSET);
+    if (COMPACT_STORAGE) {
+        return vec4(unpackHalf2x16(scale_opacity_words[base]), unpackHalf2x16(scale_opacity_words[base + 1]));
+    }
+    return uintBitsToFloat(uvec4(scale_opacity_words[base], scale_opacity_words[base + 1],
+                                 scale_opacity_words[base + 2], scale_opacity_words[base + 3]));
+}
+
+float load_opacity(uint index) {
+    uint base = index * SCALE_OPACITY_STRIDE + (SOA_LAYOUT ? 0 : SCALE_OPACITY_OFFSET);
+    if (COMPACT_STORAGE) {
+        return unpackHalf2x16(scale_opacity_words[base + 1]).y;
+    }
+    return uintBitsToFloat(scale_opacity_words[base + 3]);
+}
+
+vec4 load_rotation(uint index) {
+    uint base = index * ROTATION_STRIDE + (SOA_LAYOUT ? 0 : ROTATION_OFFSET);
+    if (COMPACT_STORAGE) {
+        return vec4(unpackHalf2x16(rotation_words[base]), unpackHalf2x16(rotation_words[base + 1]));
+    }
+    return uintBitsToFloat(uvec4(rotation_words[base], rotation_words[base + 1], rotation_words[base + 2],
+                                 rotation_words[base + 3]));
+}
+
+// rgb of SH coefficient 0..SH_COEFFICIENTS - 1
+vec3 load_sh(uint index, uint coefficient) {
+    uint base = index * SH_STRIDE + (SOA_LAYOUT ? 0 : SH_OFFSET);
+    if (COMPACT_STORAGE) {
+        vec2 dc_rg = unpackHalf2x16(sh_words[base]);
+        vec2 dc_b_scale = unpackHalf2x16(sh_words[base + 1]);
+        if (coefficient == 0) {
+            return vec3(dc_rg, dc_b_scale.x);
+        }
+
+        vec3 sh;
+        for (uint c = 0; c < 3; c++) {
+            uint byte_index = (coefficient - 1) * 3 + c;
+            int quantized = bitfieldExtract(int(sh_words[base + 2 + byte_index / 4]), int(byte_index % 4) * 8, 8);
+            sh[c] = float(quantized) / 127.0;
+        }
+        return sh * dc_b_scale.y;
+    }
+
+    uint offset = base + coefficient * 3;
+    return uintBitsToFloat(uvec3(sh_words[offset], sh_words[offset + 1], sh_words[offset + 2]));
+}
@@ -0,0 +1,43 @@
+// Workgroup wide exclusive prefix sum for shaders that define WORKGROUP_SIZE and enable the subgroup basic and
+// arithmetic extensions
+
+// the smallest subgroups have 8 invocations
+#define MAX_SUBGROUPS (WORKGROUP_SIZE / 8)
+
+shared uint subgroup_sums[MAX_SUBGROUPS];
+shared uint workgroup_sum;
+
+// Exclusive prefix sum of one value per invocation over the workgroup, total is the sum of all values. Has to be
+// reached by the whole workgroup.
+uint workgroupExclusiveAdd(uint value, out uint total) {
+    uint exclusive = subgroupExclusiveAdd(value);
+    uint sum = subgroupAdd(value);
+    if (subgroupElect()) {
+        subgroup_sums[gl_SubgroupID] = sum;
+    }
+    barrier();
+
+    // there can be more subgroups than invocations in a subgroup, so the first one walks over them
+    if (gl_SubgroupID == 0) {
+        uint carry = 0;
+        for (uint first = 0; first < gl_NumSubgroups; first += gl_SubgroupSize) {
+            uint i = first + gl_SubgroupInvocationID;
+            uint subgroup_sum = i < gl_NumSubgroups ? subgroup_sums[i] : 0;
+            uint scanned = subgroupExclusiveAdd(subgroup_sum);
+            if (i < gl_NumSubgroups) {
+                subgroup_sums[i] = carry + scanned;
+            }
+            carry += subgroupAdd(subgroup_sum);
+        }
+        if (subgroupElect()) {
+            workgroup_sum = carry;
+        }
+    }
+    barrier();
+
+    exclusive += subgroup_sums[gl_SubgroupID];
+    total = workgroup_sum;
+    // the shared sums are reused by the next call
+    barrier();
+    return exclusive;
+}
@@ -43,7 +43,7 @@ void Buffer::alloc() {
     }
 }
 
-Buffer::Buffer(const std::shared_ptr<VulkanContext>& _context, uint32_t size, vk::BufferUsageFlags usage,
+Buffer::Buffer(const std::shared_ptr<VulkanContext>& _context, vk::DeviceSize size, vk::BufferUsageFlags usage,
                VmaMemoryUsage vmaUsage, VmaAllocationCreateFlags flags, bool shared, vk::DeviceSize alignment, std::string debugName)
     : context(_context),
       size(size),
@@ -104,12 +104,12 @@ void Buffer::uploadFrom(std::shared_ptr<Buffer> buffer) {
 void Buffer::downloadTo(std::shared_ptr<Buffer> buffer, vk::DeviceSize srcOffset, vk::DeviceSize dstOffset) {
     if (vmaUsage == VMA_MEMORY_USAGE_GPU_ONLY || vmaUsage == VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE) {
         auto commandBuffer = context->beginOneTimeCommandBuffer();
-        vk::BufferCopy copyRegion = {};
-        copyRegion.setSize(buffer->size);
+        vk::BufferCopy copyRegion = {srcOffset, dstOffset, buffer->size - dstOffset};
         commandBuffer->copyBuffer(this->buffer, buffer->buffer, 1, &copyRegion);
         context->endOneTimeCommandBuffer(std::move(commandBuffer), VulkanContext::Queue::COMPUTE);
     } else if (flags & VMA_ALLOCATION_CREATE_MAPPED_BIT) {
-        memcpy(buffer->allocation_info.pMappedData, allocation_info.pMappedData, buffer->size);
+        memcpy(static_cast<char *>(buffer->allocation_info.pMappedData) + dstOffset,
+               static_cast<char *>(allocation_info.pMappedData) + srcOffset, buffer->size - dstOffset);
     } else {
         throw std::runtime_error("Buffer is not mappable");
     }
@@ -156,7 +156,7 @@ std::shared_ptr<Buffer> Buffer::uniform(std::shared_ptr<VulkanContext> context,
                                     concurrentSharing);
 }
 
-std::shared_ptr<Buffer> Buffer::staging(std::shared_ptr<VulkanContext> context, unsigned long size) {
+std::shared_ptr<Buffer> Buffer::staging(std::shared_ptr<VulkanContext> context, vk::DeviceSize size) {
     return std::make_shared<Buffer>(context, size,
                                     vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
                                     VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_MAPPED_BIT |
@@ -164,6 +164,28 @@ std::shared_ptr<Buffer> Buffer::staging(std::shared_ptr<VulkanContext> context,
                                     false);
 }
 
+std::shared_ptr<Buffer> Buffer::readback(std::shared_ptr<VulkanContext> context, vk::DeviceSize size) {
+    return std::make_shared<Buffer>(context, size, vk::BufferUsageFlagBits::eTransferDst,
+                                    VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                                           VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+                                    false, 0, "Readback Buffer");
+}
+
+std::shared_ptr<Buffer> Buffer::indirect(std::shared_ptr<VulkanContext> context, uint64_t size) {
+    return std::make_shared<Buffer>(context, size,
+                                    vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer |
+                                    vk::BufferUsageFlagBits::eTransferDst,
+                                    VMA_MEMORY_USAGE_GPU_ONLY, 0, false, 0, "Indirect Buffer");
+}
+
+std::shared_ptr<Buffer> Buffer::feedback(std::shared_ptr<VulkanContext> context, uint64_t size) {
+    return std::make_shared<Buffer>(context, size,
+                                    vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                    VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                                           VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+                                    false, 0, "Feedback Buffer");
+}
+
 std::shared_ptr<Buffer> Buffer::storage(std::shared_ptr<VulkanContext> context, uint64_t size, bool concurrentSharing,
                                         vk::DeviceSize alignment, std::string debugName) {
     return std::make_shared<Buffer>(context, size,
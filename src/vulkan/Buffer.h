@@ -12,7 +12,7 @@ class DescriptorSet;
 
 class Buffer : public std::enable_shared_from_this<Buffer> {
 public:
-    Buffer(const std::shared_ptr<VulkanContext>& context, uint32_t size, vk::BufferUsageFlags usage, VmaMemoryUsage vmaUsage,
+    Buffer(const std::shared_ptr<VulkanContext>& context, vk::DeviceSize size, vk::BufferUsageFlags usage, VmaMemoryUsage vmaUsage,
            VmaAllocationCreateFlags flags, bool concurrentSharing = false, VkDeviceSize alignment = 0, std::string debugName = "Unnamed");
 
     Buffer(const Buffer &) = delete;
@@ -31,7 +31,16 @@ public:
 
     static std::shared_ptr<Buffer> uniform(std::shared_ptr<VulkanContext> context, uint32_t size, bool concurrentSharing = false);
 
-    static std::shared_ptr<Buffer> staging(std::shared_ptr<VulkanContext> context, unsigned long size);
+    static std::shared_ptr<Buffer> staging(std::shared_ptr<VulkanContext> context, vk::DeviceSize size);
+
+    // host memory the GPU copies into, cached for reading and invalidated by the reader
+    static std::shared_ptr<Buffer> readback(std::shared_ptr<VulkanContext> context, vk::DeviceSize size);
+
+    // storage buffer that can also hold the arguments of indirect dispatches
+    static std::shared_ptr<Buffer> indirect(std::shared_ptr<VulkanContext> context, uint64_t size);
+
+    // storage buffer the shaders write and the host reads and clears through its mapping
+    static std::shared_ptr<Buffer> feedback(std::shared_ptr<VulkanContext> context, uint64_t size);
 
     static std::shared_ptr<Buffer> storage(std::shared_ptr<VulkanContext> context, uint64_t size, bool concurrentSharing = false, vk::DeviceSize alignment = 0, std
                                            ::string debugName = "Unnamed Storage Buffer");
@@ -16,6 +16,22 @@ void DescriptorSet::bindBufferToDescriptorSet(uint32_t binding, vk::DescriptorTy
     });
 }
 
+void DescriptorSet::bindBufferToDescriptorSet(uint32_t binding, vk::DescriptorType type, vk::ShaderStageFlagBits stage,
+                                              const std::vector<std::shared_ptr<Buffer>>& frameBuffers) {
+    if (frameBuffers.size() != framesInFlight) {
+        throw std::runtime_error("Binding " + std::to_string(binding) + " needs one buffer per frame in flight");
+    }
+
+    // the first frame's buffer stands for the binding in the layout and the options
+    bindBufferToDescriptorSet(binding, type, stage, frameBuffers[0]);
+    for (auto& buffer: frameBuffers) {
+        frameBindings[binding].push_back(DescriptorBinding{
+            type, bindings[binding][0].layoutBinding, buffer,
+            vk::DescriptorBufferInfo(buffer->buffer, 0, buffer->size)
+        });
+    }
+}
+
 void DescriptorSet::build() {
     std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
     for (auto&[_, options]: bindings) {
@@ -43,7 +59,13 @@ void DescriptorSet::build() {
         std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
         for (auto&binding: bindings) {
             for (auto j = 0; j < maxOptions; j++) {
-                if (binding.second.size() == 1) {
+                if (frameBindings.contains(binding.first)) {
+                    auto&frameBinding = frameBindings.at(binding.first)[i];
+                    frameBinding.buffer->boundToDescriptorSet(static_cast<std::weak_ptr<DescriptorSet>>(shared_from_this()), i * maxOptions + j, binding.first, frameBinding.type);
+                    writeDescriptorSets.emplace_back(descriptorSets[i * maxOptions + j].get(), binding.first, 0, 1,
+                                                     frameBinding.type, nullptr, &frameBinding.bufferInfo);
+                }
+                else if (binding.second.size() == 1) {
                     if (binding.second[0].buffer != nullptr) {
                         binding.second[0].buffer->boundToDescriptorSet(static_cast<std::weak_ptr<DescriptorSet>>(shared_from_this()), i * maxOptions + j, binding.first, binding.second[0].type);
                         writeDescriptorSets.emplace_back(descriptorSets[i * maxOptions + j].get(), binding.first, 0, 1,
@@ -30,6 +30,10 @@ public:
 
     void bindBufferToDescriptorSet(uint32_t binding, vk::DescriptorType type, vk::ShaderStageFlagBits stage, std::shared_ptr<Buffer> buffer);
 
+    // Binds one buffer per frame in flight, e.g. buffers the host writes while the other frames are running
+    void bindBufferToDescriptorSet(uint32_t binding, vk::DescriptorType type, vk::ShaderStageFlagBits stage,
+                                   const std::vector<std::shared_ptr<Buffer>>& frameBuffers);
+
     void build();
 
     vk::DescriptorSet getDescriptorSet(uint8_t currentFrame, uint8_t option) const;
@@ -45,6 +49,7 @@ private:
     const std::shared_ptr<VulkanContext> context;
     const uint8_t framesInFlight;
     std::unordered_map<uint32_t, std::vector<DescriptorBinding>> bindings;
+    std::unordered_map<uint32_t, std::vector<DescriptorBinding>> frameBindings;
 };
 
 
@@ -30,6 +30,10 @@ public:
 
     void load();
 
+    [[nodiscard]] const std::string& getFilename() const {
+        return filename;
+    }
+
     vk::UniqueShaderModule shader;
 private:
     const std::string filename;
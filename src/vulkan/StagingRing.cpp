@@ -0,0 +1,114 @@
+#include "StagingRing.h"
+
+#include "spdlog/spdlog.h"
+
+StagingRing::StagingRing(const std::shared_ptr<VulkanContext>& context, Direction direction, vk::DeviceSize size,
+                         uint32_t numSlices)
+    : context(context), direction(direction), sliceSize(size / numSlices) {
+    buffer = direction == Direction::READBACK
+                 ? Buffer::readback(context, sliceSize * numSlices)
+                 : Buffer::staging(context, sliceSize * numSlices);
+
+    vk::CommandPoolCreateInfo poolInfo = {};
+    poolInfo.queueFamilyIndex = context->queues[VulkanContext::Queue::COMPUTE].queueFamily;
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient;
+    commandPool = context->device->createCommandPoolUnique(poolInfo);
+
+    auto commandBuffers = context->device->allocateCommandBuffersUnique(
+        vk::CommandBufferAllocateInfo(commandPool.get(), vk::CommandBufferLevel::ePrimary, numSlices));
+
+    slices.reserve(numSlices);
+    for (uint32_t i = 0; i < numSlices; i++) {
+        slices.push_back(Slice{
+            static_cast<char *>(buffer->allocation_info.pMappedData) + i * sliceSize,
+            i * sliceSize,
+            std::move(commandBuffers[i]),
+            context->device->createFenceUnique(vk::FenceCreateInfo{}),
+        });
+    }
+}
+
+StagingRing::~StagingRing() {
+    try {
+        flush();
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to wait for staging ring: {}", e.what());
+    }
+}
+
+void StagingRing::wait(Slice& slice) {
+    if (!slice.pending) {
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto ret = context->device->waitForFences(slice.fence.get(), VK_TRUE, UINT64_MAX);
+    if (ret != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to wait for fence");
+    }
+    context->device->resetFences(slice.fence.get());
+    slice.pending = false;
+    if (direction == Direction::READBACK) {
+        vmaInvalidateAllocation(context->allocator, buffer->allocation, slice.offset, sliceSize);
+    }
+    waitTime += std::chrono::high_resolution_clock::now() - start;
+
+    if (slice.onComplete) {
+        auto onComplete = std::move(slice.onComplete);
+        slice.onComplete = nullptr;
+        onComplete();
+    }
+}
+
+StagingRing::Slice& StagingRing::acquire() {
+    auto& slice = slices[nextSlice];
+    nextSlice = (nextSlice + 1) % slices.size();
+
+    wait(slice);
+    slice.commandBuffer->reset();
+    slice.commandBuffer->begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    return slice;
+}
+
+void StagingRing::copy(Slice& slice, vk::DeviceSize srcOffset, const std::shared_ptr<Buffer>& dst,
+                       vk::DeviceSize dstOffset, vk::DeviceSize size) {
+    if (srcOffset + size > sliceSize) {
+        throw std::runtime_error("Staging slice overflow");
+    }
+    vk::BufferCopy copyRegion = {slice.offset + srcOffset, dstOffset, size};
+    slice.commandBuffer->copyBuffer(buffer->buffer, dst->buffer, 1, &copyRegion);
+}
+
+void StagingRing::readback(Slice& slice, const std::shared_ptr<Buffer>& src, vk::DeviceSize srcOffset,
+                           vk::DeviceSize dstOffset, vk::DeviceSize size) {
+    if (direction != Direction::READBACK) {
+        throw std::runtime_error("Reading back through an upload staging ring");
+    }
+    if (dstOffset + size > sliceSize) {
+        throw std::runtime_error("Staging slice overflow");
+    }
+    vk::BufferCopy copyRegion = {srcOffset, slice.offset + dstOffset, size};
+    slice.commandBuffer->copyBuffer(src->buffer, buffer->buffer, 1, &copyRegion);
+
+    vk::MemoryBarrier memoryBarrier{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead};
+    slice.commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+                                         memoryBarrier, nullptr, nullptr);
+}
+
+void StagingRing::submit(Slice& slice, std::function<void()> onComplete) {
+    slice.commandBuffer->end();
+    auto submitInfo = vk::SubmitInfo{}.setCommandBuffers(slice.commandBuffer.get());
+    {
+        std::lock_guard<std::mutex> lock(context->queueMutex);
+        context->queues[VulkanContext::Queue::COMPUTE].queue.submit(submitInfo, slice.fence.get());
+    }
+    slice.pending = true;
+    slice.onComplete = std::move(onComplete);
+}
+
+void StagingRing::flush() {
+    // oldest slice first, so that the completion callbacks keep their order
+    for (size_t i = 0; i < slices.size(); i++) {
+        wait(slices[(nextSlice + i) % slices.size()]);
+    }
+}
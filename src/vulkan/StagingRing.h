@@ -0,0 +1,81 @@
+#ifndef STAGINGRING_H
+#define STAGINGRING_H
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "VulkanContext.h"
+#include "Buffer.h"
+
+// Fixed-size host-visible staging memory split into slices. Each slice has its own command buffer and fence,
+// so the CPU can fill one slice while the transfers recorded for the previous slices are still running.
+class StagingRing {
+public:
+    // Upload rings are write-combined memory the CPU must not read, readback rings are cached and get invalidated
+    // before the completion callback of a slice runs
+    enum class Direction {
+        UPLOAD,
+        READBACK,
+    };
+
+    static constexpr vk::DeviceSize DEFAULT_SIZE = 64 * 1024 * 1024;
+    static constexpr uint32_t DEFAULT_NUM_SLICES = 4;
+
+    struct Slice {
+        char* data;
+        vk::DeviceSize offset; // offset of the slice in the ring buffer
+        vk::UniqueCommandBuffer commandBuffer;
+        vk::UniqueFence fence;
+        bool pending = false;
+        std::function<void()> onComplete;
+    };
+
+    explicit StagingRing(const std::shared_ptr<VulkanContext>& context, Direction direction = Direction::UPLOAD,
+                         vk::DeviceSize size = DEFAULT_SIZE, uint32_t numSlices = DEFAULT_NUM_SLICES);
+
+    StagingRing(const StagingRing &) = delete;
+
+    StagingRing &operator=(const StagingRing &) = delete;
+
+    ~StagingRing();
+
+    [[nodiscard]] vk::DeviceSize getSliceSize() const {
+        return sliceSize;
+    }
+
+    // Waits until the oldest slice is no longer in use and starts recording its command buffer
+    Slice& acquire();
+
+    // Records a copy of [srcOffset, srcOffset + size) of the slice into dst
+    void copy(Slice& slice, vk::DeviceSize srcOffset, const std::shared_ptr<Buffer>& dst, vk::DeviceSize dstOffset,
+              vk::DeviceSize size);
+
+    // Records a copy of [srcOffset, srcOffset + size) of src into the slice at dstOffset, readback rings only
+    void readback(Slice& slice, const std::shared_ptr<Buffer>& src, vk::DeviceSize srcOffset, vk::DeviceSize dstOffset,
+                  vk::DeviceSize size);
+
+    // onComplete runs on the calling thread once the slice finished executing, callbacks run in submission order
+    void submit(Slice& slice, std::function<void()> onComplete = {});
+
+    // Waits for all submitted slices
+    void flush();
+
+    // time the CPU spent waiting for slices to become free
+    std::chrono::high_resolution_clock::duration waitTime{};
+
+private:
+    std::shared_ptr<VulkanContext> context;
+    Direction direction;
+    std::shared_ptr<Buffer> buffer;
+    vk::DeviceSize sliceSize;
+    vk::UniqueCommandPool commandPool;
+    std::vector<Slice> slices;
+    uint32_t nextSlice = 0;
+
+    void wait(Slice& slice);
+};
+
+
+#endif //STAGINGRING_H
@@ -122,7 +122,10 @@ void Swapchain::createSwapchainImages() {
 }
 
 void Swapchain::recreate() {
-    context->device->waitIdle();
+    {
+        std::lock_guard<std::mutex> lock(context->queueMutex);
+        context->device->waitIdle();
+    }
     swapchain.reset();
     swapchainImages.clear();
 
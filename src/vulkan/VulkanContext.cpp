@@ -1,4 +1,7 @@
 #include "VulkanContext.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_map>
@@ -204,11 +207,11 @@ VulkanContext::QueueFamilyIndices VulkanContext::findQueueFamilies() {
 void VulkanContext::createQueryPool() {
     vk::QueryPoolCreateInfo queryPoolCreateInfo = {};
     queryPoolCreateInfo.queryType = vk::QueryType::eTimestamp;
-    queryPoolCreateInfo.queryCount = 20;
+    queryPoolCreateInfo.queryCount = QUERIES_PER_FRAME * FRAMES_IN_FLIGHT;
     queryPool = device->createQueryPoolUnique(queryPoolCreateInfo);
 
     auto commandBuffer = beginOneTimeCommandBuffer();
-    commandBuffer->resetQueryPool(queryPool.get(), 0, 12);
+    commandBuffer->resetQueryPool(queryPool.get(), 0, QUERIES_PER_FRAME * FRAMES_IN_FLIGHT);
     endOneTimeCommandBuffer(std::move(commandBuffer), Queue::GRAPHICS);
 }
 
@@ -287,6 +290,7 @@ void VulkanContext::endOneTimeCommandBuffer(vk::UniqueCommandBuffer&& commandBuf
     vk::SubmitInfo submitInfo = {};
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &*commandBuffer;
+    std::lock_guard<std::mutex> lock(queueMutex);
     queues[queue].queue.submit(submitInfo, nullptr);
     queues[queue].queue.waitIdle();
 }
@@ -313,19 +317,109 @@ void VulkanContext::createDescriptorPool(uint8_t framesInFlight) {
     // get max number of descriptor sets from physical device
     std::vector<vk::DescriptorPoolSize> poolSizes = {
         {vk::DescriptorType::eUniformBuffer, static_cast<uint32_t>(framesInFlight * 10)},
-        {vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>(framesInFlight * 50)},
+        {vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>(framesInFlight * 100)},
         {vk::DescriptorType::eStorageImage, static_cast<uint32_t>(framesInFlight * 10)}
     };
 
     vk::DescriptorPoolCreateInfo poolInfo{
         vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-        100, static_cast<uint32_t>(poolSizes.size()),
+        static_cast<uint32_t>(framesInFlight * 100), static_cast<uint32_t>(poolSizes.size()),
         poolSizes.data()
     };
 
     descriptorPool = device->createDescriptorPoolUnique(poolInfo);
 }
 
+// Header of the pipeline cache file. The driver checks its own header too, but only for the device it was built
+// on, and a driver update keeps the same pipeline cache UUID on some vendors.
+struct PipelineCacheFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t driverVersion;
+    uint8_t deviceUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+};
+
+static constexpr char PIPELINE_CACHE_MAGIC[8] = {'V', 'K', 'G', 'S', 'P', 'C', 'A', '\0'};
+static constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+static PipelineCacheFileHeader pipelineCacheHeaderFor(vk::PhysicalDevice physicalDevice) {
+    auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+    PipelineCacheFileHeader header{};
+    memcpy(header.magic, PIPELINE_CACHE_MAGIC, sizeof(PIPELINE_CACHE_MAGIC));
+    header.version = PIPELINE_CACHE_VERSION;
+    header.driverVersion = properties.get<vk::PhysicalDeviceProperties2>().properties.driverVersion;
+    memcpy(header.deviceUUID, properties.get<vk::PhysicalDeviceIDProperties>().deviceUUID.data(), VK_UUID_SIZE);
+    return header;
+}
+
+void VulkanContext::createPipelineCache(const std::string& path) {
+    pipelineCachePath = path;
+    std::vector<char> data;
+
+    std::error_code error;
+    if (!path.empty() && std::filesystem::exists(path, error)) {
+        auto expected = pipelineCacheHeaderFor(physicalDevice);
+        PipelineCacheFileHeader header{};
+        std::ifstream file(path, std::ios::binary);
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!file || memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+            header.version != expected.version) {
+            spdlog::info("Ignoring invalid pipeline cache {}", path);
+        } else if (header.driverVersion != expected.driverVersion ||
+                   memcmp(header.deviceUUID, expected.deviceUUID, VK_UUID_SIZE) != 0) {
+            spdlog::info("Ignoring pipeline cache {} from another device or driver", path);
+        } else if (auto fileSize = std::filesystem::file_size(path, error);
+            error || fileSize - sizeof(header) != header.dataSize) {
+            // the size comes from the file, a corrupted one must not make us allocate whatever it says
+            spdlog::info("Ignoring pipeline cache {} whose size does not match its header", path);
+        } else {
+            data.resize(header.dataSize);
+            file.read(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!file) {
+                spdlog::info("Ignoring truncated pipeline cache {}", path);
+                data.clear();
+            }
+        }
+    }
+
+    vk::PipelineCacheCreateInfo createInfo{{}, data.size(), data.empty() ? nullptr : data.data()};
+    pipelineCache = device->createPipelineCacheUnique(createInfo);
+    if (!data.empty()) {
+        spdlog::info("Loaded pipeline cache {} ({} KB)", path, data.size() / 1024);
+    }
+}
+
+void VulkanContext::savePipelineCache() {
+    if (!pipelineCache || pipelineCachePath.empty()) {
+        return;
+    }
+
+    auto data = device->getPipelineCacheData(pipelineCache.get());
+    auto header = pipelineCacheHeaderFor(physicalDevice);
+    header.dataSize = data.size();
+
+    // written next to the old file first, so that a crash does not leave a truncated cache behind
+    auto tempPath = pipelineCachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            spdlog::warn("Could not write pipeline cache {}", tempPath);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, pipelineCachePath, error);
+    if (error) {
+        spdlog::warn("Could not write pipeline cache {}: {}", pipelineCachePath, error.message());
+        return;
+    }
+    spdlog::debug("Saved pipeline cache {} ({} KB)", pipelineCachePath, data.size() / 1024);
+}
+
 VulkanContext::~VulkanContext() {
+    savePipelineCache();
     vmaDestroyAllocator(allocator);
 }
@@ -3,8 +3,11 @@
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #define VULKAN_HPP_TYPESAFE_CONVERSION
 
-#define FRAMES_IN_FLIGHT 1
+#define FRAMES_IN_FLIGHT 2
+// timestamp queries each frame in flight can write
+#define QUERIES_PER_FRAME 20
 
+#include <mutex>
 #include <optional>
 #include <set>
 #include <unordered_map>
@@ -80,6 +83,13 @@ public:
 
     void createDescriptorPool(uint8_t framesInFlight);
 
+    // Creates the pipeline cache all pipelines are built with, seeded from the file at path if it was written for
+    // this device and driver. An empty path keeps the cache in memory.
+    void createPipelineCache(const std::string &path);
+
+    // Writes the pipeline cache back to the file it was created from
+    void savePipelineCache();
+
     vk::UniqueCommandBuffer beginOneTimeCommandBuffer();
 
     void endOneTimeCommandBuffer(vk::UniqueCommandBuffer &&commandBuffer, Queue::Type queue);
@@ -91,10 +101,13 @@ public:
     std::optional<vk::UniqueSurfaceKHR> surface;
     vk::UniqueDevice device;
     std::unordered_map<Queue::Type, Queue> queues;
+    // scenes can be streamed from a loader thread, submissions to the queues have to be serialized
+    std::mutex queueMutex;
     VmaAllocator allocator;
 
     vk::UniqueDescriptorPool descriptorPool;
     vk::UniqueQueryPool queryPool;
+    vk::UniquePipelineCache pipelineCache;
 
     bool validationLayersEnabled;
 private:
@@ -103,6 +116,8 @@ private:
 
     vk::UniqueCommandPool commandPool;
 
+    std::string pipelineCachePath;
+
     void setupVma();
 
     void createCommandPool();
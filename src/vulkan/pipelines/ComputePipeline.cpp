@@ -2,6 +2,10 @@
 
 #include "ComputePipeline.h"
 
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+
 ComputePipeline::ComputePipeline(const std::shared_ptr<VulkanContext>& context, std::shared_ptr<Shader> shader): Pipeline(context), shader(std::move(shader)) {
     this->shader->load();
 }
@@ -9,7 +13,13 @@ ComputePipeline::ComputePipeline(const std::shared_ptr<VulkanContext>& context,
 void ComputePipeline::build() {
     buildPipelineLayout();
 
-    vk::PipelineShaderStageCreateInfo pipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, shader->shader.get(), "main");
+    vk::SpecializationInfo specializationInfo(specializationMapEntries.size(), specializationMapEntries.data(),
+                                              specializationData.size() * sizeof(uint32_t), specializationData.data());
+    vk::PipelineShaderStageCreateInfo pipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, shader->shader.get(), "main",
+                                                                    specializationMapEntries.empty() ? nullptr : &specializationInfo);
     vk::ComputePipelineCreateInfo computePipelineCreateInfo({}, pipelineShaderStageCreateInfo, pipelineLayout.get());
-    pipeline = context->device->createComputePipelineUnique(nullptr, computePipelineCreateInfo).value;
+    auto start = std::chrono::high_resolution_clock::now();
+    pipeline = context->device->createComputePipelineUnique(context->pipelineCache.get(), computePipelineCreateInfo).value;
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start);
+    spdlog::debug("Created pipeline {} in {:.2f} ms", shader->getFilename(), elapsed.count());
 }
@@ -50,3 +50,8 @@ void Pipeline::bind(const vk::UniqueCommandBuffer &commandBuffer, uint8_t curren
 void Pipeline::addPushConstant(vk::ShaderStageFlags stageFlags, uint32_t offset, uint32_t size) {
     pushConstantRanges.emplace_back(stageFlags, offset, size);
 }
+
+void Pipeline::addSpecializationConstant(uint32_t constantId, uint32_t value) {
+    specializationMapEntries.emplace_back(constantId, specializationData.size() * sizeof(uint32_t), sizeof(uint32_t));
+    specializationData.push_back(value);
+}
@@ -35,6 +35,9 @@ public:
 
     void addPushConstant(vk::ShaderStageFlags stageFlags, uint32_t offset, uint32_t size);
 
+    // 32-bit specialization constant, bool constants take 0 or 1
+    void addSpecializationConstant(uint32_t constantId, uint32_t value);
+
     virtual void build() = 0;
 
     virtual void bind(const vk::UniqueCommandBuffer &commandBuffer, uint8_t currentFrame, DescriptorOption option);
@@ -47,6 +50,8 @@ protected:
     std::shared_ptr<VulkanContext> context;
     std::vector<vk::DescriptorSetLayoutBinding> descriptorSetLayoutBindings;
     std::vector<vk::PushConstantRange> pushConstantRanges;
+    std::vector<vk::SpecializationMapEntry> specializationMapEntries;
+    std::vector<uint32_t> specializationData;
 
     std::map<uint32_t, std::shared_ptr<DescriptorSet>> descriptorSets;
 };